@@ -0,0 +1,344 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "quadblox_engine.h"
+#include "quadblox_alloc.h"
+#ifdef QUADBLOX_BENCH_RENDER
+#include "quadblox.h"
+#include "quadblox_pack.h"
+#endif
+
+// Microbenchmarks of the engine's hot paths on every instantiated board size and, when built with SDL, of
+// GameRender on the software renderer. Each iteration count is doubled until a run takes BENCH_MIN_SECONDS, then the
+// best of BENCH_REPEATS runs is kept, in nanoseconds per operation, along with the heap allocations per operation.
+// --json prints the results as one JSON document for scripts to compare against earlier builds.
+// --only name runs only the benchmarks whose name contains name.
+
+const double BENCH_MIN_SECONDS = 0.02;
+const int BENCH_REPEATS = 5;
+const int BENCH_MAX_RESULTS = 64;
+// Pieces cycled through by the per-piece benchmarks
+const int BENCH_PIECES = 256;
+
+typedef struct BenchResult {
+    char name[48];
+    long long iterations;
+    double nsPerOp;
+    double allocsPerOp;
+} BenchResult;
+
+typedef struct Bench {
+    bool json = false;
+    const char* only = NULL;
+    BenchResult results[BENCH_MAX_RESULTS];
+    int numResults = 0;
+} Bench;
+
+// Results fold into here so the optimizer can't drop the work
+static volatile uint64 benchSink;
+
+static double runSeconds( std::chrono::steady_clock::time_point start ) {
+    return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
+
+// body( n ) runs n operations
+template <typename Body>
+static void run( Bench* bench, const char* name, Body body ) {
+    if ( ( bench->only != NULL && strstr( name, bench->only ) == NULL ) || bench->numResults == BENCH_MAX_RESULTS ) {
+        return;
+    }
+    long long iterations = 1;
+    for ( ;; ) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        body( iterations );
+        if ( runSeconds( start ) >= BENCH_MIN_SECONDS ) {
+            break;
+        }
+        iterations *= 2;
+    }
+    double best = 0;
+    uint64 allocations = AllocationsOnThread();
+    for ( int i = 0; i < BENCH_REPEATS; i++ ) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        body( iterations );
+        double seconds = runSeconds( start );
+        best = i == 0 || seconds < best ? seconds : best;
+    }
+
+    BenchResult& result = bench->results[bench->numResults++];
+    snprintf( result.name, sizeof( result.name ), "%s", name );
+    result.iterations = iterations;
+    result.nsPerOp = best * 1e9 / double( iterations );
+    result.allocsPerOp = double( AllocationsOnThread() - allocations ) / double( iterations * BENCH_REPEATS );
+    if ( !bench->json ) {
+        printf( "%-34s %12lld ops %12.1f ns/op %8.3f allocs/op\n", result.name, result.iterations, result.nsPerOp,
+                result.allocsPerOp );
+    }
+}
+
+static uint64 nextRandom( uint64* state ) {
+    *state = *state * 6364136223846793005ull + 1442695040888963407ull;
+    return *state >> 33;
+}
+
+// The lower three quarters filled, each row one cell short of full, with a consistent hash and metrics
+template <int W, int H>
+static void fillBoard( BasicGameState<W, H>* gameState, uint64 seed ) {
+    InitGame( gameState );
+    SeedGame( gameState, seed );
+    for ( int row = H / 4; row < H; row++ ) {
+        BoardRow<W> bits = 0;
+        for ( int col = 0; col < W; col++ ) {
+            if ( nextRandom( &seed ) % 3 != 0 ) {
+                bits = BoardRow<W>( bits | BoardRow<W>( 1 ) << ( W - col - 1 ) );
+            }
+        }
+        bits = BoardRow<W>( bits & ~( BoardRow<W>( 1 ) << nextRandom( &seed ) % W ) );
+        gameState->blockBake[row] = bits;
+        for ( int col = 0; col < W; col++ ) {
+            gameState->blockColor[row][col] = int8( ( bits >> ( W - col - 1 ) ) & 1 ? row % NUM_BLOCKTYPES : -1 );
+        }
+    }
+    gameState->boardHash = BoardHash<W, H>( gameState->blockBake );
+    BoardMetricsFromRows( &gameState->metrics, gameState->blockBake );
+}
+
+// Every piece type and rotation, at any column and at heights from the spawn row to just above the filled rows
+template <int W, int H>
+static void makePieces( QuadBlock* pieces, uint64 seed ) {
+    for ( int i = 0; i < BENCH_PIECES; i++ ) {
+        QuadBlock& qb = pieces[i];
+        qb.blockType = int( nextRandom( &seed ) % NUM_BLOCKTYPES );
+        qb.currentState = 0;
+        RotateBlock( qb, int( nextRandom( &seed ) % NUM_BLOCKSTATES ) );
+        const BlockOnBoard<W>& b = OnBoard<W>( qb );
+        qb.x = b.minX + int( nextRandom( &seed ) % uint64( b.maxX - b.minX + 1 ) );
+        qb.y = -Top( qb ) + int( nextRandom( &seed ) % uint64( H / 4 + 1 ) );
+    }
+}
+
+template <int W, int H>
+static void benchEngine( Bench* bench ) {
+    char name[48];
+    BasicGameState<W, H>* base = new BasicGameState<W, H>;
+    BasicGameState<W, H>* state = new BasicGameState<W, H>;
+    fillBoard( base, 1 );
+    QuadBlock pieces[BENCH_PIECES];
+    makePieces<W, H>( pieces, 2 );
+
+    snprintf( name, sizeof( name ), "blockHitsBake/%dx%d", W, H );
+    run( bench, name, [&]( long long n ) {
+        uint64 hits = 0;
+        for ( long long i = 0; i < n; i++ ) {
+            hits += blockHitsBake<W, H>( pieces[i % BENCH_PIECES], base->blockBake, 1, 0 );
+        }
+        benchSink = hits;
+    } );
+
+    // The board is restored once per pass over the pieces, so the copy is spread over BENCH_PIECES bakes
+    snprintf( name, sizeof( name ), "bakeBlock/%dx%d", W, H );
+    run( bench, name, [&]( long long n ) {
+        for ( long long i = 0; i < n; i++ ) {
+            if ( i % BENCH_PIECES == 0 ) {
+                *state = *base;
+            }
+            bakeBlock( state, &pieces[i % BENCH_PIECES] );
+        }
+        benchSink = state->boardHash;
+    } );
+
+    snprintf( name, sizeof( name ), "findCompleteRows/%dx%d", W, H );
+    run( bench, name, [&]( long long n ) {
+        int rows[4];
+        int numRows = 0;
+        uint64 found = 0;
+        for ( long long i = 0; i < n; i++ ) {
+            findCompleteRows( base->metrics, pieces[i % BENCH_PIECES], rows, numRows );
+            found += uint64( numRows );
+        }
+        benchSink = found;
+    } );
+
+    // Four full rows spread through the board. Every clear starts from a copy, timed on its own just below.
+    BasicGameState<W, H>* full = new BasicGameState<W, H>;
+    *full = *base;
+    int fullRows[4] = { H / 2, H / 2 + 3, H - 4, H - 1 };
+    for ( int i = 0; i < 4; i++ ) {
+        full->blockBake[fullRows[i]] = FullRow<W>();
+        memset( full->blockColor[fullRows[i]], i, sizeof( full->blockColor[0] ) );
+        full->completeRows[i] = fullRows[i];
+    }
+    full->numCompleteRows = 4;
+    full->boardHash = BoardHash<W, H>( full->blockBake );
+    BoardMetricsFromRows( &full->metrics, full->blockBake );
+
+    snprintf( name, sizeof( name ), "copyState/%dx%d", W, H );
+    run( bench, name, [&]( long long n ) {
+        for ( long long i = 0; i < n; i++ ) {
+            *state = *full;
+            benchSink = state->boardHash;
+        }
+    } );
+
+    snprintf( name, sizeof( name ), "ClearCompletedRows/%dx%d", W, H );
+    run( bench, name, [&]( long long n ) {
+        for ( long long i = 0; i < n; i++ ) {
+            *state = *full;
+            ClearCompletedRows( state );
+        }
+        benchSink = state->boardHash;
+    } );
+
+    snprintf( name, sizeof( name ), "SpawnQuadBlock/%dx%d", W, H );
+    run( bench, name, [&]( long long n ) {
+        uint64 sum = 0;
+        for ( long long i = 0; i < n; i++ ) {
+            QuadBlock qb = SpawnQuadBlock( state, int( i % NUM_BLOCKTYPES ) );
+            sum += uint64( qb.x + qb.currentState );
+        }
+        benchSink = sum;
+    } );
+
+    // Whole games on random input, as headless plays them, one tick per operation
+    snprintf( name, sizeof( name ), "updateGame/%dx%d", W, H );
+    InitGame( state );
+    SeedGame( state, 3 );
+    uint64 inputSeed = 4;
+    run( bench, name, [&]( long long n ) {
+        for ( long long i = 0; i < n; i++ ) {
+            GameInput input;
+            switch ( nextRandom( &inputSeed ) % 16 ) {
+                case 0: input.horizMove = -1; break;
+                case 1: input.horizMove = 1; break;
+                case 2: input.rotate = 1; break;
+                case 3: input.turboOn = true; break;
+                default: break;
+            }
+            GameStep( state, input );
+            if ( state->gameOver ) {
+                InitGame( state );
+            }
+        }
+        benchSink = state->tick;
+    } );
+
+    delete base;
+    delete state;
+    delete full;
+}
+
+#ifdef QUADBLOX_BENCH_RENDER
+static SDL_Texture* solidTexture( SDL_Renderer* renderer, int size, Uint8 r, Uint8 g, Uint8 b ) {
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat( 0, size, size, 32, SDL_PIXELFORMAT_RGBA32 );
+    SDL_FillRect( surface, NULL, SDL_MapRGBA( surface->format, r, g, b, 0xFF ) );
+    SDL_Texture* texture = SDL_CreateTextureFromSurface( renderer, surface );
+    SDL_FreeSurface( surface );
+    return texture;
+}
+
+// GameRender into an offscreen surface, with plain coloured squares standing in for the block images
+static bool benchRender( Bench* bench ) {
+    SDL_Surface* screen = SDL_CreateRGBSurfaceWithFormat( 0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888 );
+    SDL_Renderer* renderer = screen ? SDL_CreateSoftwareRenderer( screen ) : NULL;
+    if ( renderer == NULL ) {
+        printf( "No software renderer: %s\n", SDL_GetError() );
+        SDL_FreeSurface( screen );
+        return false;
+    }
+    SDL_SetRenderDrawBlendMode( renderer, SDL_BLENDMODE_BLEND );
+
+    Assets* assets = new Assets();
+    SDL_Surface* blocks[NUM_BLOCKTYPES];
+    for ( int i = 0; i < NUM_BLOCKTYPES; i++ ) {
+        blocks[i] = SDL_CreateRGBSurfaceWithFormat( 0, 32, 32, 32, SDL_PIXELFORMAT_RGBA32 );
+        SDL_FillRect( blocks[i], NULL, SDL_MapRGBA( blocks[i]->format, Uint8( 40 * i ), 0x80, Uint8( 255 - 30 * i ), 0xFF ) );
+    }
+    SDL_Rect rects[NUM_BLOCKTYPES + 1];
+    SDL_Surface* atlas = PackBlockAtlas( blocks, rects );
+    for ( int i = 0; i < NUM_BLOCKTYPES; i++ ) {
+        SDL_FreeSurface( blocks[i] );
+        assets->blockRects[i] = rects[i];
+    }
+    assets->whiteRect = rects[NUM_BLOCKTYPES];
+    assets->blockAtlas = SDL_CreateTextureFromSurface( renderer, atlas );
+    assets->blockAtlasWidth = atlas->w;
+    assets->blockAtlasHeight = atlas->h;
+    SDL_FreeSurface( atlas );
+    SDL_SetTextureBlendMode( assets->blockAtlas, SDL_BLENDMODE_BLEND );
+    assets->textures[AssetType::BACKGROUND] = solidTexture( renderer, 64, 0xCC, 0xCC, 0xCC );
+    SpriteBatchInit( &assets->sprites );
+
+    GameState* gameState = new GameState;
+    fillBoard( gameState, 5 );
+    gameState->currentBlock = SpawnQuadBlock( gameState, 6 );
+    gameState->hasCurrentBlock = true;
+    GameSnapshot* snapshot = new GameSnapshot;
+    TakeSnapshot( *gameState, NULL, 0, snapshot );
+
+    // Nothing changes between frames, so the cached board layer is reused every time
+    run( bench, "GameRender/cached", [&]( long long n ) {
+        for ( long long i = 0; i < n; i++ ) {
+            GameRender( renderer, assets, snapshot, 0 );
+        }
+    } );
+    // Every row redrawn into the layer every frame, as on the frame after a clear
+    run( bench, "GameRender/redraw", [&]( long long n ) {
+        for ( long long i = 0; i < n; i++ ) {
+            assets->boardLayer.valid = false;
+            GameRender( renderer, assets, snapshot, 0 );
+        }
+    } );
+
+    SDL_DestroyTexture( assets->textures[AssetType::BACKGROUND] );
+    SDL_DestroyTexture( assets->blockAtlas );
+    if ( assets->boardLayer.texture ) {
+        SDL_DestroyTexture( assets->boardLayer.texture );
+    }
+    delete assets;
+    delete gameState;
+    delete snapshot;
+    SDL_DestroyRenderer( renderer );
+    SDL_FreeSurface( screen );
+    return true;
+}
+#endif
+
+static void printJson( const Bench* bench ) {
+    printf( "{\"benchmarks\":[\n" );
+    for ( int i = 0; i < bench->numResults; i++ ) {
+        const BenchResult& result = bench->results[i];
+        printf( "{\"name\":\"%s\",\"iterations\":%lld,\"ns_per_op\":%.3f,\"allocs_per_op\":%.3f}%s\n", result.name,
+                result.iterations, result.nsPerOp, result.allocsPerOp, i + 1 < bench->numResults ? "," : "" );
+    }
+    printf( "]}\n" );
+}
+
+int main( int argc, char** argv ) {
+    Bench* bench = new Bench;
+    for ( int i = 1; i < argc; i++ ) {
+        if ( strcmp( argv[i], "--json" ) == 0 ) {
+            bench->json = true;
+        } else if ( strcmp( argv[i], "--only" ) == 0 && i + 1 < argc ) {
+            bench->only = argv[++i];
+        } else {
+            printf( "usage: quadblox_bench [--json] [--only name]\n" );
+            delete bench;
+            return 1;
+        }
+    }
+
+    benchEngine<PLAYAREA_WIDTH, PLAYAREA_HEIGHT>( bench );
+    benchEngine<WIDE_WIDTH, WIDE_HEIGHT>( bench );
+    benchEngine<HUGE_WIDTH, HUGE_HEIGHT>( bench );
+    bool ok = true;
+#ifdef QUADBLOX_BENCH_RENDER
+    ok = benchRender( bench );
+#endif
+
+    if ( bench->json ) {
+        printJson( bench );
+    }
+    delete bench;
+    return ok ? 0 : 1;
+}
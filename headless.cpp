@@ -0,0 +1,633 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include "quadblox_engine.h"
+#include "quadblox_alloc.h"
+#include "quadblox_bot.h"
+#include "quadblox_batch.h"
+#include "quadblox_perft.h"
+#include "quadblox_replay.h"
+#include "quadblox_rollback.h"
+#include "quadblox_server.h"
+#include "quadblox_threadpool.h"
+#include "quadblox_ttable.h"
+
+// Runs the rules engine with no window or renderer and reports throughput.
+// Input comes from a random generator, or from the bot with --bot.
+// --batch N instead steps N boards in lockstep through the vectorized batch simulator.
+// --record saves the session's input log, --replay re-runs one at full speed and prints the final checksum.
+// Replay and bot runs jump over idle ticks instead of stepping them, unless --fixed-step is given.
+// --board 16x40 or 64x128 runs random input on one of the larger instantiated boards.
+// --serve N hosts N games at once across the worker threads; --connect plays one of them over the server's socket.
+// --perft N counts every placement sequence N pieces deep from --start (a board file, empty by default) with the
+// pieces in --pieces, and reports the counts and the move generator's nodes/s.
+// --rollback N plays random input that arrives N ticks late over a loopback, predicting no input and rolling back
+// on every misprediction, then checks the result against a run that had the input on time.
+// --bench-clears N times N four-row clears on each board size, against the per-row cascade they replaced.
+// Heap allocations made while stepping are counted and printed; --check-allocs fails the run if there were any.
+
+typedef struct HeadlessOptions {
+    long long numTicks = 10000000;
+    uint64 seed = 1;
+    bool bot = false;
+    // Pieces searched past the current one. The first is the preview, the rest are unknown.
+    int depth = 1;
+    int threads = 0;
+    BotWeights weights;
+    // Transposition table for the bot's search, 0 to search without one
+    int tableMegabytes = 16;
+    int batchBoards = 0;
+    BatchKernel::Enum kernel = BatchKernel::AUTO;
+    const char* recordPath = NULL;
+    const char* replayPath = NULL;
+    bool fixedStep = false;
+    int boardWidth = PLAYAREA_WIDTH;
+    int boardHeight = PLAYAREA_HEIGHT;
+    int serveGames = 0;
+    int remoteGames = 0;
+    const char* socketPath = NULL;
+    bool realtime = false;
+    const char* connectPath = NULL;
+    int rollbackDelay = -1;
+    int perftDepth = 0;
+    const char* perftPieces = "TIOLJSZT";
+    const char* perftStart = NULL;
+    long long benchClears = 0;
+    bool checkAllocs = false;
+} HeadlessOptions;
+
+GameInput randomInput() {
+    GameInput input;
+    switch ( rand() % 16 ) {
+        case 0: input.horizMove = -1; break;
+        case 1: input.horizMove = 1; break;
+        case 2: input.rotate = 1; break;
+        case 3: input.turboOn = true; break;
+        default: break;
+    }
+    return input;
+}
+
+void printUsage() {
+    printf( "usage: quadblox_headless [--ticks N] [--seed N] [--bot] [--depth N] [--threads N] [--tt megabytes]\n"
+            "                         [--weights height,lines,holes,bumpiness]\n"
+            "                         [--batch boards] [--kernel auto|scalar|sse2|avx2]\n"
+            "                         [--record file] [--replay file] [--fixed-step]\n"
+            "                         [--board 10x20|16x40|64x128]\n"
+            "                         [--serve games [--remote N --socket path] [--realtime]] [--connect path]\n"
+            "                         [--rollback delay] [--perft depth [--pieces JLSZOTI?] [--start file]]\n"
+            "                         [--bench-clears rounds] [--check-allocs]\n" );
+}
+
+bool parseOptions( int argc, char** argv, HeadlessOptions& options ) {
+    for ( int i = 1; i < argc; i++ ) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if ( strcmp( arg, "--bot" ) == 0 ) {
+            options.bot = true;
+            continue;
+        }
+        if ( strcmp( arg, "--fixed-step" ) == 0 ) {
+            options.fixedStep = true;
+            continue;
+        }
+        if ( strcmp( arg, "--realtime" ) == 0 ) {
+            options.realtime = true;
+            continue;
+        }
+        if ( strcmp( arg, "--check-allocs" ) == 0 ) {
+            options.checkAllocs = true;
+            continue;
+        }
+        if ( value == NULL ) {
+            return false;
+        }
+        i++;
+        if ( strcmp( arg, "--ticks" ) == 0 ) {
+            options.numTicks = atoll( value );
+        } else if ( strcmp( arg, "--seed" ) == 0 ) {
+            options.seed = strtoull( value, NULL, 10 );
+        } else if ( strcmp( arg, "--depth" ) == 0 ) {
+            options.depth = atoi( value );
+        } else if ( strcmp( arg, "--threads" ) == 0 ) {
+            options.threads = atoi( value );
+        } else if ( strcmp( arg, "--tt" ) == 0 ) {
+            options.tableMegabytes = atoi( value );
+        } else if ( strcmp( arg, "--weights" ) == 0 ) {
+            BotWeights& w = options.weights;
+            if ( sscanf( value, "%lf,%lf,%lf,%lf", &w.aggregateHeight, &w.linesCleared, &w.holes, &w.bumpiness ) != 4 ) {
+                return false;
+            }
+        } else if ( strcmp( arg, "--batch" ) == 0 ) {
+            options.batchBoards = atoi( value );
+        } else if ( strcmp( arg, "--kernel" ) == 0 ) {
+            int kernel = 0;
+            while ( kernel < BatchKernel::COUNT && strcmp( value, BatchKernelName( BatchKernel::Enum( kernel ) ) ) != 0 ) {
+                kernel++;
+            }
+            if ( kernel == BatchKernel::COUNT ) {
+                return false;
+            }
+            options.kernel = BatchKernel::Enum( kernel );
+        } else if ( strcmp( arg, "--record" ) == 0 ) {
+            options.recordPath = value;
+        } else if ( strcmp( arg, "--replay" ) == 0 ) {
+            options.replayPath = value;
+        } else if ( strcmp( arg, "--serve" ) == 0 ) {
+            options.serveGames = atoi( value );
+        } else if ( strcmp( arg, "--remote" ) == 0 ) {
+            options.remoteGames = atoi( value );
+        } else if ( strcmp( arg, "--socket" ) == 0 ) {
+            options.socketPath = value;
+        } else if ( strcmp( arg, "--connect" ) == 0 ) {
+            options.connectPath = value;
+        } else if ( strcmp( arg, "--perft" ) == 0 ) {
+            options.perftDepth = atoi( value );
+        } else if ( strcmp( arg, "--pieces" ) == 0 ) {
+            options.perftPieces = value;
+        } else if ( strcmp( arg, "--start" ) == 0 ) {
+            options.perftStart = value;
+        } else if ( strcmp( arg, "--bench-clears" ) == 0 ) {
+            options.benchClears = atoll( value );
+        } else if ( strcmp( arg, "--rollback" ) == 0 ) {
+            options.rollbackDelay = atoi( value );
+        } else if ( strcmp( arg, "--board" ) == 0 ) {
+            if ( sscanf( value, "%dx%d", &options.boardWidth, &options.boardHeight ) != 2 ) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Whether batch board b matches a game seeded the same way and stepped with no input for as many ticks
+static bool batchMatchesGame( const BatchSim& sim, int b, uint64 seed ) {
+    GameState gameState;
+    InitGame( &gameState );
+    SeedGame( &gameState, seed + uint64( b ) );
+    GameInput none;
+    while ( gameState.tick < sim.ticks ) {
+        GameStep( &gameState, none );
+        if ( gameState.gameOver ) {
+            InitGame( &gameState );
+        }
+    }
+
+    uint16 piece[PLAYAREA_HEIGHT] = { 0 };
+    if ( gameState.hasCurrentBlock ) {
+        const QuadBlock& qb = gameState.currentBlock;
+        for ( int i = 0; i < 4; i++ ) {
+            if ( qb.y + i >= 0 && qb.y + i < PLAYAREA_HEIGHT ) {
+                piece[qb.y + i] = BoardRowMask( qb, i, qb.x );
+            }
+        }
+    }
+    uint16 batchRows[PLAYAREA_HEIGHT];
+    uint16 batchPiece[PLAYAREA_HEIGHT];
+    BatchBoard( &sim, b, batchRows, batchPiece );
+    return memcmp( batchRows, gameState.blockBake, sizeof( batchRows ) ) == 0 && memcmp( batchPiece, piece, sizeof( piece ) ) == 0;
+}
+
+int runBatch( const HeadlessOptions& options ) {
+    BatchSim sim;
+    if ( !BatchInit( &sim, options.batchBoards, options.seed, options.kernel ) ) {
+        printf( "Kernel %s is not supported on this CPU\n", BatchKernelName( options.kernel ) );
+        return 1;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    BatchStep( &sim, int( options.numTicks ) );
+    double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+    double boardTicks = double( sim.ticks ) * sim.numBoards;
+    printf( "%d boards x %lld ticks (%s) in %.3fs: %.0f board-ticks/s, %lld games, %lld lines\n", sim.numBoards, sim.ticks,
+            BatchKernelName( sim.kernel ), seconds, boardTicks / seconds, sim.gamesFinished, sim.linesCleared );
+
+    // The first and last boards replayed through GameStep must end where the batch left them
+    bool match = sim.numBoards == 0 || ( batchMatchesGame( sim, 0, options.seed ) &&
+                                         batchMatchesGame( sim, sim.numBoards - 1, options.seed ) );
+    printf( "%s\n", match ? "boards match GameStep with no input" : "boards DIFFER from GameStep with no input" );
+    return match ? 0 : 1;
+}
+
+int runServer( const HeadlessOptions& options ) {
+    ServerOptions server;
+    server.numGames = options.serveGames;
+    server.numThreads = options.threads;
+    server.numTicks = options.numTicks;
+    server.seed = options.seed;
+    server.driver = options.bot ? GameDriver::BOT : GameDriver::RANDOM;
+    server.depth = options.depth;
+    server.weights = options.weights;
+    server.tableBytes = size_t( options.tableMegabytes > 0 ? options.tableMegabytes : 0 ) << 20;
+    server.numRemote = options.remoteGames;
+    server.socketPath = options.socketPath;
+    server.realtime = options.realtime;
+
+    ServerStats stats;
+    if ( !RunServer( server, &stats ) ) {
+        return 1;
+    }
+    PrintServerStats( stats );
+    return 0;
+}
+
+// Board file: one line per row, # for a block and . for empty. Lines beyond the width are ignored, and a file with
+// fewer rows than the board fills it from the bottom.
+static bool loadBoard( const char* path, GameBlocks board ) {
+    FILE* file = fopen( path, "r" );
+    if ( file == NULL ) {
+        printf( "Failed to open %s\n", path );
+        return false;
+    }
+    GameBlocks rows = { 0 };
+    int numRows = 0;
+    char line[256];
+    while ( numRows < PLAYAREA_HEIGHT && fgets( line, sizeof( line ), file ) ) {
+        for ( int col = 0; col < PLAYAREA_WIDTH && line[col] != '\0' && line[col] != '\n'; col++ ) {
+            if ( line[col] == '#' ) {
+                rows[numRows] = uint16( rows[numRows] | ( 1 << ( PLAYAREA_WIDTH - col - 1 ) ) );
+            }
+        }
+        numRows++;
+    }
+    fclose( file );
+    for ( int row = 0; row < PLAYAREA_HEIGHT; row++ ) {
+        int from = row - ( PLAYAREA_HEIGHT - numRows );
+        board[row] = from >= 0 ? rows[from] : 0;
+    }
+    return true;
+}
+
+int runPerft( const HeadlessOptions& options ) {
+    int pieces[PERFT_MAX_DEPTH];
+    int numPieces = ParsePerftPieces( options.perftPieces, pieces, PERFT_MAX_DEPTH );
+    int depth = options.perftDepth > PERFT_MAX_DEPTH ? PERFT_MAX_DEPTH : options.perftDepth;
+    if ( numPieces < depth ) {
+        printf( "--pieces needs at least %d of JLSZOTI or ?\n", depth );
+        return 1;
+    }
+    GameBlocks board = { 0 };
+    if ( options.perftStart != NULL && !loadBoard( options.perftStart, board ) ) {
+        return 1;
+    }
+
+    ThreadPool pool( options.threads );
+    PerftResult result = Perft( board, pieces, depth, &pool );
+    for ( int i = 0; i < depth; i++ ) {
+        printf( "depth %d: %lld placements, %lld topped out, %lld lines\n", i + 1, result.placements[i],
+                result.toppedOut[i], result.lines[i] );
+    }
+    long long nodes = PerftNodes( result );
+    printf( "%lld nodes on %d threads in %.3fs: %.0f nodes/s\n", nodes, pool.NumThreads(), result.seconds,
+            double( nodes ) / result.seconds );
+    return 0;
+}
+
+// Input for one tick of the loopback, a pure function of the tick so both runs see the same stream
+static GameInput loopbackInput( uint64 seed, uint32 tick ) {
+    uint64 z = ( ( seed << 32 | tick ) ^ ( seed >> 32 ) ) * 0x9E3779B97F4A7C15ull;
+    z = ( z ^ ( z >> 29 ) ) * 0xBF58476D1CE4E5B9ull;
+    GameInput input;
+    switch ( ( z >> 40 ) % 16 ) {
+        case 0: input.horizMove = -1; break;
+        case 1: input.horizMove = 1; break;
+        case 2: input.rotate = 1; break;
+        case 3: input.turboOn = true; break;
+        default: break;
+    }
+    return input;
+}
+
+int runRollback( const HeadlessOptions& options ) {
+    uint32 delay = uint32( options.rollbackDelay );
+    if ( delay >= ROLLBACK_TICKS ) {
+        printf( "--rollback delay must be below %u ticks\n", ROLLBACK_TICKS );
+        return 1;
+    }
+    uint32 numTicks = uint32( options.numTicks );
+
+    // Reference: every input on time
+    GameState reference;
+    InitGame( &reference );
+    SeedGame( &reference, options.seed );
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while ( reference.tick < numTicks ) {
+        GameStep( &reference, loopbackInput( options.seed, reference.tick ) );
+        if ( reference.gameOver ) {
+            InitGame( &reference );
+        }
+    }
+    double referenceSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+    // Loopback: step on a prediction of no input, correct each tick once its input arrives delay ticks later
+    RollbackBuffer* buffer = new RollbackBuffer;
+    GameState gameState;
+    InitGame( &gameState );
+    SeedGame( &gameState, options.seed );
+    GameInput predicted;
+    start = std::chrono::steady_clock::now();
+    uint64 allocations = AllocationsOnThread();
+    while ( gameState.tick < numTicks ) {
+        RollbackStep( buffer, &gameState, predicted );
+        if ( gameState.tick > delay ) {
+            uint32 arrived = gameState.tick - 1 - delay;
+            RollbackCorrect( buffer, &gameState, arrived, loopbackInput( options.seed, arrived ) );
+        }
+    }
+    for ( uint32 tick = numTicks > delay ? numTicks - delay : 0; tick < numTicks; tick++ ) {
+        RollbackCorrect( buffer, &gameState, tick, loopbackInput( options.seed, tick ) );
+    }
+    allocations = AllocationsOnThread() - allocations;
+    double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+    uint64 checksum = GameChecksum( &gameState );
+    bool match = checksum == GameChecksum( &reference );
+    printf( "%u ticks, input %u ticks late: %lld rollbacks, %lld ticks resimulated\n", numTicks, delay,
+            buffer->rollbacks, buffer->resimulatedTicks );
+    printf( "rollback run %.3fs (%.0f ticks/s), on-time run %.3fs (%.0f ticks/s)\n", seconds, double( numTicks ) / seconds,
+            referenceSeconds, double( numTicks ) / referenceSeconds );
+    printf( "seed %llu, final checksum %016llx, %s\n", (unsigned long long)options.seed, (unsigned long long)checksum,
+            match ? "matches the on-time run" : "DIFFERS from the on-time run" );
+    printf( "heap allocations: %llu while stepping\n", (unsigned long long)allocations );
+    delete buffer;
+    return match && !( options.checkAllocs && allocations > 0 ) ? 0 : 1;
+}
+
+// Random input on a board of any instantiated size. The bot, batch and replay paths only know the classic board.
+template <int W, int H>
+int runBoard( const HeadlessOptions& options ) {
+    srand( unsigned( options.seed ^ ( options.seed >> 32 ) ) );
+    BasicGameState<W, H> gameState;
+    InitGame( &gameState );
+    SeedGame( &gameState, options.seed );
+
+    long long games = 1;
+    long long lines = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while ( gameState.tick < options.numTicks ) {
+        GameStep( &gameState, randomInput() );
+        if ( gameState.gameOver ) {
+            lines += gameState.linesCleared;
+            InitGame( &gameState );
+            games++;
+        }
+    }
+    double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    lines += gameState.linesCleared;
+
+    printf( "%dx%d board, %lld ticks in %.3fs: %.0f ticks/s, %lld games, %lld lines\n", W, H, options.numTicks, seconds,
+            double(options.numTicks) / seconds, games, lines );
+    printf( "seed %llu, final checksum %016llx\n", (unsigned long long)options.seed,
+            (unsigned long long)GameChecksum( &gameState ) );
+    InitGame( &gameState );
+    return 0;
+}
+
+static int compareRows( const void* a, const void* b ) {
+    return *(const int*)a - *(const int*)b;
+}
+
+// The clear ClearCompletedRows used to do, kept as the benchmark's baseline: every cleared row moves each row above
+// it down by one, so a four-row clear near the floor copies most of the board four times
+template <int W, int H>
+static void cascadeClear( BasicGameState<W, H>* gameState ) {
+    qsort( gameState->completeRows, size_t( gameState->numCompleteRows ), sizeof( int ), compareRows );
+    for ( int rowClearedIdx = 0; rowClearedIdx < gameState->numCompleteRows; rowClearedIdx++ ) {
+        for ( int to = gameState->completeRows[rowClearedIdx]; to > 0; to-- ) {
+            int from = to - 1;
+            gameState->rowVersion[to]++;
+            gameState->boardHash ^= ZobristRow<W>( to, gameState->blockBake[to] ) ^ ZobristRow<W>( to, gameState->blockBake[from] );
+            gameState->blockBake[to] = gameState->blockBake[from];
+            for ( int col = 0; col < W; col++ ) {
+                gameState->blockColor[to][col] = gameState->blockColor[from][col];
+            }
+            gameState->rowVersion[from]++;
+            gameState->boardHash ^= ZobristRow<W>( from, gameState->blockBake[from] );
+            gameState->blockBake[from] = 0;
+            for ( int col = 0; col < W; col++ ) {
+                gameState->blockColor[from][col] = -1;
+            }
+        }
+    }
+    BoardMetricsClearRows( &gameState->metrics, gameState->blockBake, gameState->completeRows, gameState->numCompleteRows );
+    gameState->linesCleared += gameState->numCompleteRows;
+}
+
+template <int W, int H>
+static bool sameMetrics( const BoardMetrics<W, H>& a, const BoardMetrics<W, H>& b ) {
+    return memcmp( a.rowFill, b.rowFill, sizeof( a.rowFill ) ) == 0 &&
+           memcmp( a.columnHeight, b.columnHeight, sizeof( a.columnHeight ) ) == 0 && a.filledCells == b.filledCells &&
+           a.aggregateHeight == b.aggregateHeight && a.holes == b.holes && a.bumpiness == b.bumpiness &&
+           a.maxHeight == b.maxHeight;
+}
+
+// Four full rows spread through a board that is three quarters full, cleared rounds times by each implementation.
+// Both runs restore the board before every clear, so the times include one board copy each.
+template <int W, int H>
+static bool benchClears( long long rounds ) {
+    BasicGameState<W, H>* board = new BasicGameState<W, H>;
+    InitGame( board );
+    uint64 z = 0x9E3779B97F4A7C15ull;
+    for ( int row = H / 4; row < H; row++ ) {
+        z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBull + uint64( row );
+        BoardRow<W> bits = BoardRow<W>( z & FullRow<W>() & ~( BoardRow<W>( 1 ) << ( z >> 58 ) % W ) );
+        board->blockBake[row] = bits;
+        for ( int col = 0; col < W; col++ ) {
+            board->blockColor[row][col] = int8( ( bits >> ( W - col - 1 ) ) & 1 ? row % NUM_BLOCKTYPES : -1 );
+        }
+    }
+    int full[4] = { H / 2, H / 2 + 3, H - 4, H - 1 };
+    for ( int i = 0; i < 4; i++ ) {
+        board->blockBake[full[i]] = FullRow<W>();
+        for ( int col = 0; col < W; col++ ) {
+            board->blockColor[full[i]][col] = int8( i );
+        }
+        board->completeRows[i] = full[i];
+    }
+    board->numCompleteRows = 4;
+    board->boardHash = BoardHash<W, H>( board->blockBake );
+    BoardMetricsFromRows( &board->metrics, board->blockBake );
+
+    BasicGameState<W, H>* cascade = new BasicGameState<W, H>;
+    BasicGameState<W, H>* compact = new BasicGameState<W, H>;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for ( long long i = 0; i < rounds; i++ ) {
+        *cascade = *board;
+        cascadeClear( cascade );
+    }
+    double cascadeSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    start = std::chrono::steady_clock::now();
+    for ( long long i = 0; i < rounds; i++ ) {
+        *compact = *board;
+        ClearCompletedRows( compact );
+    }
+    double compactSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+    // Both runs update metrics through BoardMetricsClearRows, so the compacted board's are checked against a rescan
+    BoardMetrics<W, H> rescanned;
+    BoardMetricsFromRows( &rescanned, compact->blockBake );
+    bool match = memcmp( cascade->blockBake, compact->blockBake, sizeof( cascade->blockBake ) ) == 0 &&
+                 memcmp( cascade->blockColor, compact->blockColor, sizeof( cascade->blockColor ) ) == 0 &&
+                 sameMetrics( compact->metrics, rescanned ) && compact->boardHash == BoardHash<W, H>( compact->blockBake ) &&
+                 cascade->boardHash == compact->boardHash;
+    double perRound = 1e9 / double( rounds );
+    printf( "%dx%d: cascade %.0f ns, compaction %.0f ns per four-row clear (%.1fx)%s\n", W, H, cascadeSeconds * perRound,
+            compactSeconds * perRound, cascadeSeconds / compactSeconds, match ? "" : ", RESULTS DIFFER" );
+    delete board;
+    delete cascade;
+    delete compact;
+    return match;
+}
+
+int runBenchClears( const HeadlessOptions& options ) {
+    bool match = benchClears<PLAYAREA_WIDTH, PLAYAREA_HEIGHT>( options.benchClears );
+    match &= benchClears<WIDE_WIDTH, WIDE_HEIGHT>( options.benchClears );
+    match &= benchClears<HUGE_WIDTH, HUGE_HEIGHT>( options.benchClears );
+    return match ? 0 : 1;
+}
+
+int main( int argc, char** argv ) {
+    HeadlessOptions options;
+    if ( !parseOptions( argc, argv, options ) ) {
+        printUsage();
+        return 1;
+    }
+    if ( options.batchBoards > 0 ) {
+        return runBatch( options );
+    }
+    if ( options.serveGames > 0 ) {
+        return runServer( options );
+    }
+    if ( options.connectPath != NULL ) {
+        return RunClient( options.connectPath, options.weights ) ? 0 : 1;
+    }
+    if ( options.rollbackDelay >= 0 ) {
+        return runRollback( options );
+    }
+    if ( options.perftDepth > 0 ) {
+        return runPerft( options );
+    }
+    if ( options.benchClears > 0 ) {
+        return runBenchClears( options );
+    }
+    if ( options.boardWidth != PLAYAREA_WIDTH || options.boardHeight != PLAYAREA_HEIGHT ) {
+        if ( options.bot || options.recordPath != NULL || options.replayPath != NULL ) {
+            printf( "--bot, --record and --replay only run on the %dx%d board\n", PLAYAREA_WIDTH, PLAYAREA_HEIGHT );
+            return 1;
+        }
+        if ( options.boardWidth == WIDE_WIDTH && options.boardHeight == WIDE_HEIGHT ) {
+            return runBoard<WIDE_WIDTH, WIDE_HEIGHT>( options );
+        }
+        if ( options.boardWidth == HUGE_WIDTH && options.boardHeight == HUGE_HEIGHT ) {
+            return runBoard<HUGE_WIDTH, HUGE_HEIGHT>( options );
+        }
+        printf( "No engine instantiated for a %dx%d board\n", options.boardWidth, options.boardHeight );
+        return 1;
+    }
+
+    ReplayState replay;
+    if ( options.replayPath != NULL ) {
+        if ( !LoadInputLog( options.replayPath, &replay.log ) ) {
+            return 1;
+        }
+        replay.playing = true;
+        options.seed = replay.log.seed;
+        options.numTicks = replay.log.endTick;
+    } else if ( options.recordPath != NULL ) {
+        if ( !ReplayStartRecording( &replay, options.recordPath ) ) {
+            return 1;
+        }
+        replay.log.seed = options.seed;
+    }
+    srand( unsigned( options.seed ^ ( options.seed >> 32 ) ) );
+
+    ThreadPool* pool = options.bot ? new ThreadPool( options.threads ) : NULL;
+    TranspositionTable* table = options.bot && options.tableMegabytes > 0 ? new TranspositionTable( size_t( options.tableMegabytes ) << 20 ) : NULL;
+    int upcoming[16];
+    int depth = options.depth < 0 ? 0 : ( options.depth > 16 ? 16 : options.depth );
+    BotSearchResult plan;
+    long long searchNodes = 0;
+
+    GameState gameState;
+    InitGame( &gameState );
+    SeedGame( &gameState, options.seed );
+
+    // Random input is drawn every tick, so only replays and the bot can skip without changing the run
+    bool skipIdle = !options.fixedStep && ( replay.playing || options.bot );
+    long long games = 1;
+    long long lines = 0;
+    long long steps = 0;
+    // Bot searches run on the pool's workers too, so every thread counts
+    uint64 loopAllocations = AllocationsInProcess();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while ( gameState.tick < options.numTicks ) {
+        GameInput input;
+        if ( replay.playing ) {
+            // Input comes from the log
+        } else if ( !options.bot ) {
+            input = randomInput();
+        } else if ( gameState.hasCurrentBlock ) {
+            if ( !plan.found ) {
+                for ( int i = 0; i < depth; i++ ) {
+                    upcoming[i] = i == 0 ? gameState.nextBlockType : -1;
+                }
+                plan = BotSearch( gameState.blockBake, gameState.boardHash, gameState.metrics, gameState.currentBlock,
+                                  upcoming, depth, options.weights, pool, table );
+                searchNodes += plan.nodes;
+            }
+            if ( plan.found ) {
+                input = BotInputToward( &gameState, plan.placement );
+            }
+        }
+
+        if ( skipIdle && InputIsEmpty( input ) ) {
+            uint32 idle = GameTicksUntilEvent( &gameState );
+            uint32 untilInput = ReplayTicksUntilInput( &replay, gameState.tick );
+            if ( untilInput < idle ) idle = untilInput;
+            if ( options.numTicks - gameState.tick < idle ) idle = uint32( options.numTicks - gameState.tick );
+            if ( idle > 0 ) {
+                ReplaySkipTicks( &replay, gameState.tick, idle );
+                GameSkipTicks( &gameState, idle );
+                continue;
+            }
+        }
+
+        GameStep( &gameState, ReplayTick( &replay, gameState.tick, input ) );
+        steps++;
+        if ( !gameState.hasCurrentBlock ) {
+            plan.found = false;
+        }
+        if ( gameState.gameOver ) {
+            lines += gameState.linesCleared;
+            InitGame( &gameState );
+            games++;
+        }
+    }
+    double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    uint64 stepAllocations = AllocationsInProcess() - loopAllocations;
+    lines += gameState.linesCleared;
+
+    printf( "%lld ticks (%lld stepped) in %.3fs: %.0f ticks/s, %lld games, %lld lines\n", options.numTicks, steps, seconds,
+            double(options.numTicks) / seconds, games, lines );
+    printf( "seed %llu, final checksum %016llx\n", (unsigned long long)options.seed,
+            (unsigned long long)GameChecksum( &gameState ) );
+    if ( replay.recording && !ReplayFinishRecording( &replay ) ) {
+        printf( "Failed to save input log to %s\n", options.recordPath );
+    }
+    if ( options.bot ) {
+        printf( "bot: %lld nodes searched on %d threads, %.0f nodes/s\n", searchNodes, pool->NumThreads(), double(searchNodes) / seconds );
+    }
+    if ( table ) {
+        printf( "transposition table: %zuMB, %llu probes, %.1f%% hits\n", table->SizeBytes() >> 20,
+                (unsigned long long)table->Probes(), 100.0 * double( table->Hits() ) / double( table->Probes() ? table->Probes() : 1 ) );
+    }
+    printf( "heap allocations: %llu while stepping\n", (unsigned long long)stepAllocations );
+    InitGame( &gameState );
+    delete table;
+    delete pool;
+    return options.checkAllocs && stepAllocations > 0 ? 1 : 0;
+}
@@ -1,41 +1,134 @@
+#include <thread>
 #include "SDL.h"
 #include "SDL_image.h"
 #include "SDL_ttf.h"
 
 #include "quadblox.h"
+#include "quadblox_alloc.h"
+#include "quadblox_pacing.h"
+#include "quadblox_pack.h"
+#include "quadblox_profile.h"
+#include "quadblox_sim.h"
+#include "quadblox_threadpool.h"
 
 void PrintSDLError( const char* message ) {
     printf("%s Error: %s\n", message, SDL_GetError());
 }
 
-SDL_Texture* loadTexture( const char* path, SDL_Renderer* renderer ) {
-    SDL_Texture* newTexture = NULL;
-    SDL_Surface* loadedSurface = IMG_Load( path );
-    if ( loadedSurface == NULL ) {
-        PrintSDLError("IMG_Load");
-    } else {
-        newTexture = SDL_CreateTextureFromSurface( renderer, loadedSurface );
-        if ( newTexture == NULL ) {
-            PrintSDLError( "SDL_CreateTextureFromSurface" );
+// One texture for all the block images, plus a white patch so highlights can be drawn in the same batch
+bool loadBlockAtlas( SDL_Renderer* renderer, Assets* assets, SDL_Surface* const* blockSurfaces ) {
+    SDL_Rect rects[NUM_BLOCKTYPES + 1];
+    SDL_Surface* atlas = PackBlockAtlas( blockSurfaces, rects );
+    if ( atlas == NULL ) {
+        PrintSDLError( "PackBlockAtlas" );
+        return false;
+    }
+
+    assets->blockAtlas = SDL_CreateTextureFromSurface( renderer, atlas );
+    assets->blockAtlasWidth = atlas->w;
+    assets->blockAtlasHeight = atlas->h;
+    SDL_FreeSurface( atlas );
+    if ( assets->blockAtlas == NULL ) {
+        PrintSDLError( "SDL_CreateTextureFromSurface" );
+        return false;
+    }
+    SDL_SetTextureBlendMode( assets->blockAtlas, SDL_BLENDMODE_BLEND );
+
+    for ( int i = 0; i < NUM_BLOCKTYPES; i++ ) {
+        assets->blockRects[i] = rects[i];
+    }
+    assets->whiteRect = rects[NUM_BLOCKTYPES];
+    SpriteBatchInit( &assets->sprites );
+    return true;
+}
+
+// One asset's trip from disk to GPU. Decoding happens on a worker thread, the upload on the render thread.
+typedef struct AssetLoad {
+    const char* name = NULL;
+    // Image to decode and the format to convert it to, SDL_PIXELFORMAT_UNKNOWN to keep it as it is
+    const char* path = NULL;
+    Uint32 convertTo = SDL_PIXELFORMAT_UNKNOWN;
+    SDL_Surface* surface = NULL;
+    Uint64 decodeTicks = 0;
+    Uint64 uploadTicks = 0;
+} AssetLoad;
+
+typedef struct GlyphLoad {
+    AssetLoad* load;
+    TTF_Font* font;
+    GlyphAtlas* glyphs;
+} GlyphLoad;
+
+// Pool tasks: decode one image, or rasterize the glyphs
+static void decodeImage( void* arg ) {
+    AssetLoad* load = (AssetLoad*)arg;
+    Uint64 decodeStart = SDL_GetPerformanceCounter();
+    load->surface = IMG_Load( load->path );
+    if ( load->surface == NULL ) {
+        PrintSDLError( "IMG_Load" );
+    } else if ( load->convertTo != SDL_PIXELFORMAT_UNKNOWN && load->surface->format->format != load->convertTo ) {
+        SDL_Surface* converted = SDL_ConvertSurfaceFormat( load->surface, load->convertTo, 0 );
+        if ( converted ) {
+            SDL_FreeSurface( load->surface );
+            load->surface = converted;
         }
-        SDL_FreeSurface( loadedSurface );
     }
-    return newTexture;
+    load->decodeTicks = SDL_GetPerformanceCounter() - decodeStart;
+}
+
+static void rasterizeGlyphs( void* arg ) {
+    GlyphLoad* glyphLoad = (GlyphLoad*)arg;
+    Uint64 decodeStart = SDL_GetPerformanceCounter();
+    glyphLoad->load->surface = RasterizeGlyphs( glyphLoad->font, glyphLoad->glyphs );
+    glyphLoad->load->decodeTicks = SDL_GetPerformanceCounter() - decodeStart;
+}
+
+static double ticksToMs( Uint64 ticks ) {
+    return 1000.0 * double(ticks) / double(SDL_GetPerformanceFrequency());
+}
+
+static void printAssetTimes( const AssetLoad* loads, int count, Uint64 totalTicks, int numThreads ) {
+    printf( "Assets loaded in %.2fms on %d threads\n", ticksToMs( totalTicks ), numThreads );
+    for ( int i = 0; i < count; i++ ) {
+        printf( "    %-12s decode %7.2fms  upload %7.2fms\n", loads[i].name, ticksToMs( loads[i].decodeTicks ), ticksToMs( loads[i].uploadTicks ) );
+    }
 }
 
 Assets* loadMedia( SDL_Renderer* renderer ) {
-    bool success = true;
     Assets* assets = new Assets();
-    
+    if ( LoadAssetPack( renderer, ASSET_PACK_FILE, assets ) ) {
+        return assets;
+    }
+    printf( "No usable %s, loading loose files from assets/\n", ASSET_PACK_FILE );
 
-    assets->font = TTF_OpenFont( "assets/OpenSans.ttf", 16 );
+    Uint64 start = SDL_GetPerformanceCounter();
+    bool success = true;
+    // Every texture file, then the block atlas they are packed into, then the glyphs
+    const int BLOCK_ATLAS_LOAD = AssetType::COUNT;
+    const int GLYPH_LOAD = AssetType::COUNT + 1;
+    AssetLoad loads[AssetType::COUNT + 2];
+    char paths[AssetType::COUNT][256];
+    loads[BLOCK_ATLAS_LOAD].name = "block atlas";
+    loads[GLYPH_LOAD].name = "glyphs";
+
+    char fontPath[256];
+    sprintf( fontPath, "assets/%s", FONT_FILE );
+    assets->font = TTF_OpenFont( fontPath, FONT_SIZE );
     if ( assets->font == NULL ) {
         printf( "Failed to open font: %s\n", TTF_GetError() );
         success = false;
     } 
 
+    // Converting to the renderer's preferred format on the worker leaves the upload a plain copy
+    SDL_RendererInfo info;
+    Uint32 textureFormat = SDL_PIXELFORMAT_ARGB8888;
+    if ( SDL_GetRendererInfo( renderer, &info ) == 0 && info.num_texture_formats > 0 ) {
+        textureFormat = info.texture_formats[0];
+    }
+
+    ThreadPool pool;
+    GlyphLoad glyphLoad;
     if ( success ) {
-        char path[256] = "assets/Block0.png";
         for ( size_t i = 0; i < AssetType::COUNT; i++ ) {
             const char* filename = AssetTextureFiles[i];
             if ( filename == NULL ) {
@@ -44,25 +137,59 @@ Assets* loadMedia( SDL_Renderer* renderer ) {
                 break;
             }
 
-            if ( strncmp(filename, "TEXT_", 5) == 0 ) {
-                SDL_Color textColor = { 0xFF, 0xFF, 0xFF, 0xFF };
-                SDL_Surface* textSurface = TTF_RenderText_Blended(assets->font, filename+5, textColor);
-                assets->textures[i] = SDL_CreateTextureFromSurface(renderer, textSurface);
-                SDL_FreeSurface(textSurface);
-                continue; 
-            }
+            sprintf( paths[i], "assets/%s", filename );
+            AssetLoad* load = &loads[i];
+            load->name = filename;
+            load->path = paths[i];
+            // Block images are packed into the atlas as they are
+            load->convertTo = IsBlockAsset( i ) ? Uint32( SDL_PIXELFORMAT_UNKNOWN ) : textureFormat;
+            pool.Submit( decodeImage, load );
+        }
 
-            sprintf( path, "assets/%s", filename );
-            assets->textures[i] = loadTexture( path, renderer );
+        glyphLoad.load = &loads[GLYPH_LOAD];
+        glyphLoad.font = assets->font;
+        glyphLoad.glyphs = &assets->glyphs;
+        pool.Submit( rasterizeGlyphs, &glyphLoad );
+        pool.Wait();
+    }
+
+    // Uploads, on this thread only
+    SDL_Surface* blockSurfaces[NUM_BLOCKTYPES] = { NULL };
+    for ( size_t i = 0; i < AssetType::COUNT && success; i++ ) {
+        if ( loads[i].surface == NULL ) {
+            printf( "Failed to load texture %s\n", paths[i] );
+            success = false;
+        } else if ( IsBlockAsset( i ) ) {
+            blockSurfaces[i] = loads[i].surface;
+        } else {
+            Uint64 uploadStart = SDL_GetPerformanceCounter();
+            assets->textures[i] = SDL_CreateTextureFromSurface( renderer, loads[i].surface );
+            loads[i].uploadTicks = SDL_GetPerformanceCounter() - uploadStart;
             if ( assets->textures[i] == NULL ) {
-                printf( "Failed to load texture %s\n", path );
+                PrintSDLError( "SDL_CreateTextureFromSurface" );
                 success = false;
-                break;
             }
         }
     }
+    if ( success ) {
+        // Packing needs every block decoded and is quick, so it happens here along with the upload
+        Uint64 uploadStart = SDL_GetPerformanceCounter();
+        success = loadBlockAtlas( renderer, assets, blockSurfaces );
+        loads[BLOCK_ATLAS_LOAD].uploadTicks = SDL_GetPerformanceCounter() - uploadStart;
+    }
+    if ( success ) {
+        Uint64 uploadStart = SDL_GetPerformanceCounter();
+        success = loads[GLYPH_LOAD].surface != NULL && UploadGlyphAtlas( renderer, loads[GLYPH_LOAD].surface, &assets->glyphs );
+        loads[GLYPH_LOAD].surface = NULL;
+        loads[GLYPH_LOAD].uploadTicks = SDL_GetPerformanceCounter() - uploadStart;
+    }
+    for ( int i = 0; i <= GLYPH_LOAD; i++ ) {
+        SDL_FreeSurface( loads[i].surface );
+    }
 
-    if ( !success ) {
+    if ( success ) {
+        printAssetTimes( loads, GLYPH_LOAD + 1, SDL_GetPerformanceCounter() - start, pool.NumThreads() );
+    } else {
         delete assets;
         assets = NULL;
     }
@@ -71,12 +198,23 @@ Assets* loadMedia( SDL_Renderer* renderer ) {
 
 void freeMedia( Assets* assets ) {
     for ( size_t i = 0; i < AssetType::COUNT; i++ ) {
-        SDL_DestroyTexture( assets->textures[i] );
+        if ( assets->textures[i] ) {
+            SDL_DestroyTexture( assets->textures[i] );
+        }
         assets->textures[i] = NULL;
     }
+    if ( assets->blockAtlas ) {
+        SDL_DestroyTexture( assets->blockAtlas );
+    }
+    assets->blockAtlas = NULL;
+    FreeGlyphAtlas( &assets->glyphs );
+    if ( assets->boardLayer.texture ) {
+        SDL_DestroyTexture( assets->boardLayer.texture );
+    }
+    assets->boardLayer.texture = NULL;
 }
 
-void initSDL( SDL_Renderer*& renderer, SDL_Window*& window ) {
+void initSDL( SDL_Renderer*& renderer, SDL_Window*& window, bool vsync ) {
     if ( SDL_Init( SDL_INIT_VIDEO ) != 0 ) {
         PrintSDLError("SDL_Init");
         return;
@@ -91,7 +229,11 @@ void initSDL( SDL_Renderer*& renderer, SDL_Window*& window ) {
         return;
     } 
 
-    renderer = SDL_CreateRenderer( window, -1, SDL_RENDERER_ACCELERATED );
+    Uint32 rendererFlags = SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE;
+    if ( vsync ) {
+        rendererFlags |= SDL_RENDERER_PRESENTVSYNC;
+    }
+    renderer = SDL_CreateRenderer( window, -1, rendererFlags );
     if ( renderer == NULL ) {
         PrintSDLError( "SDL_CreateRenderer" );
         return;
@@ -125,86 +267,71 @@ void shutdownSDL( SDL_Renderer* renderer, SDL_Window* window ) {
 }
 
 
-void gameKeydownHandler( GameState* gameState, SDL_KeyboardEvent key ) {
-    switch ( key.keysym.sym ) {
-        case SDLK_LEFT:
-            gameState->horizMove -= 1;
-            break;
-        case SDLK_RIGHT:
-            gameState->horizMove += 1;
-            break;
-        case SDLK_UP:
-            gameState->rotate += 1;
-            break;
-        case SDLK_DOWN:
-            gameState->turbo = true;
-            break;
-        case SDLK_q:
-        case SDLK_ESCAPE:
-            gameState->wantsToQuit = true;
-            break;
-        case SDLK_p:
-            gameState->paused = !gameState->paused;
-            break;
-        default:
-            break;
+// Per-stage percentiles from the profiler's last full window, right-aligned in the top corner
+static void drawProfileOverlay( SDL_Renderer* renderer, Assets* assets, const Profiler* profiler, SDL_Color color ) {
+    char line[64];
+    for ( int stage = 0; stage < ProfileStage::COUNT; stage++ ) {
+        ProfileFormatStage( profiler, ProfileStage::Enum( stage ), line, sizeof( line ) );
+        int x = SCREEN_WIDTH - MeasureText( &assets->glyphs, line ) - 8;
+        DrawText( renderer, &assets->sprites, &assets->glyphs, line, x, stage * assets->glyphs.lineSkip, color );
     }
 }
 
-void gameKeyupHandler( GameState* gameState, SDL_KeyboardEvent key ) {
-    switch ( key.keysym.sym ) {
-        case SDLK_DOWN:
-            gameState->turbo = false;
-            break;
-        default:
-            break;
-    }
-}
-
-void mainLoop( SDL_Renderer* renderer, Assets* assets ) {
+void mainLoop( SDL_Renderer* renderer, Assets* assets, ReplayState* replay, PacingMode::Enum pacingMode,
+               const char* tracePath ) {
     SDL_Event e;
 
-    GameState gameState;
-    for ( int i = 0; i < PLAYAREA_HEIGHT; i++ ) {
-        for ( int j = 0; j < PLAYAREA_WIDTH; j++ ) {
-            gameState.blockBake[i][j] = -1;
-        }
+    InputQueue input;
+    Simulation simulation;
+    Simulation* sim = &simulation;
+    InitGame( &sim->gameState );
+    if ( !replay->playing ) {
+        replay->log.seed = SDL_GetPerformanceCounter();
     }
+    SeedGame( &sim->gameState, replay->log.seed );
 
-    static const uint64_t perfFreq = SDL_GetPerformanceFrequency();
-    static const double targetTicsPerFrame = perfFreq / 60.0;
     static const double fpsSmoothing = 0.95;
-    uint64 lastTime = SDL_GetPerformanceCounter();
-    uint64 newTime;
+    FramePacer pacer;
+    PacerInit( &pacer, pacingMode, 60.0 );
+    pacer.pumpEvents = true;
+    Profiler profiler;
+    ProfilerInit( &profiler );
+    ProfileThreadBegin( &profiler, "render" );
+    InputQueueInstall( &input );
+    SimulationInit( sim, &input, replay, SDL_GetPerformanceCounter() );
+    sim->profiler = &profiler;
+    std::thread simThread( RunSimulation, sim );
     double frameTime;
     double currentFPS = 0;
     char fpsStr[4] = "000";
 
     SDL_Color textColor = { 0, 0, 0, 0xFF };
-    SDL_Surface* textSurface = NULL;
-    SDL_Texture* textTexture = NULL;
-    SDL_Rect debugRect;
-
-    while ( !gameState.wantsToQuit ) {
-        newTime = SDL_GetPerformanceCounter();
-        frameTime = newTime - lastTime;
-        if ( frameTime < targetTicsPerFrame ) {
-            continue;
-        }
-        frameTime /= double(perfFreq);
-        lastTime = newTime;
+
+    const GameSnapshot* snapshot = sim->snapshots.Latest();
+    uint64 frameStart = ProfileNow();
+    // Frames that allocated on this thread, which should be none once the board layer exists
+    uint64 allocations = AllocationsOnThread();
+    long long allocatingFrames = 0;
+    while ( !snapshot->wantsToQuit ) {
+        frameTime = PacerBeginFrame( &pacer );
+        // A frame runs from one frame start to the next, waiting included, so a stutter shows up whatever its cause
+        uint64 now = ProfileNow();
+        ProfileRecord( ProfileStage::FRAME, frameStart, now );
+        frameStart = now;
+        ProfileDrain( &profiler, now );
 
         currentFPS = ( currentFPS * fpsSmoothing ) + ( ( 1.0 / frameTime ) * ( 1.0 - fpsSmoothing ) );
         snprintf(fpsStr, 4, "%d", int(currentFPS) );
 
-        // Input handling
-        while ( SDL_PollEvent( &e ) != 0 ) {
-            if ( e.type == SDL_QUIT ) {
-                break;
-            } else if ( e.type == SDL_KEYDOWN ) {
-                gameKeydownHandler( &gameState, e.key );
-            } else if ( e.type == SDL_KEYUP ) {
-                gameKeyupHandler( &gameState, e.key );
+        // Keys reach the input queue through its event watch as they are pumped, this only drains the rest
+        {
+            ProfileScope scope( ProfileStage::INPUT );
+            while ( SDL_PollEvent( &e ) != 0 ) {
+                if ( e.type == SDL_QUIT ) {
+                    break;
+                } else if ( e.type == SDL_RENDER_TARGETS_RESET || e.type == SDL_RENDER_DEVICE_RESET ) {
+                    assets->boardLayer.valid = false;
+                }
             }
         }
 
@@ -213,27 +340,77 @@ void mainLoop( SDL_Renderer* renderer, Assets* assets ) {
         SDL_RenderClear( renderer );
 
         {
-            textSurface = TTF_RenderText_Blended(assets->font, fpsStr, textColor);
-            textTexture = SDL_CreateTextureFromSurface(renderer, textSurface);
-            debugRect = Rect(0, 0, textSurface->w, textSurface->h);
-            SDL_RenderCopy(renderer, textTexture, NULL, &debugRect);
-            SDL_FreeSurface(textSurface);
-            SDL_DestroyTexture(textTexture);
+            ProfileScope scope( ProfileStage::TEXT );
+            SpriteBatchBegin( &assets->sprites, assets->glyphs.texture, assets->glyphs.width, assets->glyphs.height );
+            DrawText( renderer, &assets->sprites, &assets->glyphs, fpsStr, 0, 0, textColor );
+            drawProfileOverlay( renderer, assets, &profiler, textColor );
+            SpriteBatchFlush( &assets->sprites, renderer );
         }
 
-        GameUpdateAndRender( renderer, assets, &gameState, frameTime );
+        {
+            ProfileScope scope( ProfileStage::DRAW );
+            snapshot = sim->snapshots.Latest();
+            GameRender( renderer, assets, snapshot, SDL_GetPerformanceCounter() );
+        }
 
         SDL_RenderSetViewport(renderer, NULL);
-        SDL_RenderPresent( renderer );
+        {
+            ProfileScope scope( ProfileStage::PRESENT );
+            SDL_RenderPresent( renderer );
+        }
+
+        uint64 frameAllocations = AllocationsOnThread();
+        allocatingFrames += frameAllocations != allocations ? 1 : 0;
+        allocations = frameAllocations;
+    }
+    sim->running = false;
+    simThread.join();
+    InputQueueRemove( &input );
+    PacerPrintStats( &pacer );
+    printf( "Render: %lld of %lld frames made heap allocations\n", allocatingFrames, pacer.frames );
+    SimulationPrintStats( sim );
+    InputQueuePrintStats( &input );
+    ProfileDrain( &profiler, ProfileNow() );
+    ProfilePrintStats( &profiler );
+    if ( tracePath != NULL && !ProfileWriteTrace( &profiler, tracePath ) ) {
+        printf( "Failed to write trace to %s\n", tracePath );
     }
 }
 
-int main( int /*argc*/, char** /*argv*/ ) {
+int main( int argc, char** argv ) {
     SDL_Renderer* renderer = NULL;
     SDL_Window* window = NULL;
     Assets* assets = NULL;
 
-    initSDL( renderer, window );
+    // --record file saves this session's input, --replay file plays one back in real time
+    // --pacing vsync|hybrid|uncapped picks how frames are paced
+    // --trace file writes the last stretch of stage timings as a Chrome trace on exit
+    ReplayState replay;
+    const char* recordPath = NULL;
+    const char* tracePath = NULL;
+    PacingMode::Enum pacingMode = PacingMode::HYBRID;
+    for ( int i = 1; i + 1 < argc; i++ ) {
+        if ( strcmp( argv[i], "--pacing" ) == 0 ) {
+            if ( !ParsePacingMode( argv[++i], &pacingMode ) ) {
+                printf( "Unknown pacing mode %s\n", argv[i] );
+                return 1;
+            }
+        } else if ( strcmp( argv[i], "--record" ) == 0 ) {
+            recordPath = argv[++i];
+        } else if ( strcmp( argv[i], "--replay" ) == 0 ) {
+            if ( !LoadInputLog( argv[++i], &replay.log ) ) {
+                return 1;
+            }
+            replay.playing = true;
+        } else if ( strcmp( argv[i], "--trace" ) == 0 ) {
+            tracePath = argv[++i];
+        }
+    }
+    if ( recordPath != NULL && !replay.playing && !ReplayStartRecording( &replay, recordPath ) ) {
+        return 1;
+    }
+
+    initSDL( renderer, window, pacingMode == PacingMode::VSYNC );
     if ( renderer == NULL || window == NULL ) {
         printf( "Failed to initialize\n" );
     } else {
@@ -242,9 +419,12 @@ int main( int /*argc*/, char** /*argv*/ ) {
         if ( assets == NULL ) {
             printf( "Failed to load media\n" );
         } else {
-            mainLoop( renderer, assets );
+            mainLoop( renderer, assets, &replay, pacingMode, tracePath );
         }
     }
+    if ( replay.recording && !ReplayFinishRecording( &replay ) ) {
+        printf( "Failed to save input log to %s\n", recordPath );
+    }
     if ( assets ) {
         freeMedia( assets );
     }
@@ -0,0 +1,22 @@
+#include "SDL.h"
+#include "SDL_image.h"
+#include "SDL_ttf.h"
+#include "quadblox_pack.h"
+
+// Build step: bakes the loose asset directory into the pack that loadMedia maps at startup
+
+int main( int argc, char** argv ) {
+    if ( argc != 3 ) {
+        printf( "usage: quadblox_pack <asset dir> <output file>\n" );
+        return 1;
+    }
+    if ( !( IMG_Init( IMG_INIT_PNG ) & IMG_INIT_PNG ) || TTF_Init() != 0 ) {
+        printf( "Failed to initialize SDL_image or SDL_ttf: %s\n", SDL_GetError() );
+        return 1;
+    }
+    bool success = WriteAssetPack( argv[1], argv[2] );
+    TTF_Quit();
+    IMG_Quit();
+    SDL_Quit();
+    return success ? 0 : 1;
+}
@@ -1,21 +1,17 @@
+#pragma once
 #include <stdint.h>
 #include "SDL.h"
 #include "SDL_ttf.h"
-
-typedef uint64_t uint64;
-typedef uint16_t uint16;
-typedef uint8_t uint8;
-
-const int PLAYAREA_WIDTH = 10;
-const int PLAYAREA_HEIGHT = 20;
+#include "quadblox_engine.h"
+#include "quadblox_replay.h"
+#include "quadblox_snapshot.h"
+#include "quadblox_sprites.h"
+#include "quadblox_text.h"
 
 const int SCREEN_WIDTH = 960;
 const int SCREEN_HEIGHT = 960;
 
 
-#define str(s) #s
-#define TEXT_FILENAME(x) str(TEXT_ ## x) 
-
 inline SDL_Rect Rect( int x, int y, int w, int h ) {
     SDL_Rect rect;
     rect.x = x;
@@ -25,15 +21,6 @@ inline SDL_Rect Rect( int x, int y, int w, int h ) {
     return rect;
 }
 
-struct QuadBlock {
-    int x;
-    int y;
-    int blockType;
-    int currentState;
-    uint16 state;
-    uint8 cols;
-};
-
 namespace AssetType {
     enum Enum : size_t {
         BLOCK0,
@@ -44,8 +31,6 @@ namespace AssetType {
         BLOCK5,
         BLOCK6,
         BACKGROUND,
-        MENU_TEXT_START,
-        MENU_TEXT_QUIT,
         COUNT
     };
 }
@@ -54,6 +39,11 @@ inline size_t AssetTypeForBlockType(int blockType) {
     return size_t(blockType);
 }
 
+// Block images are packed into Assets::blockAtlas instead of getting a texture each
+inline bool IsBlockAsset(size_t assetType) {
+    return assetType <= AssetType::BLOCK6;
+}
+
 static const char* AssetTextureFiles[AssetType::COUNT]= {
     "Block1.png",
     "Block2.png",
@@ -62,40 +52,39 @@ static const char* AssetTextureFiles[AssetType::COUNT]= {
     "Block5.png",
     "Block6.png",
     "Block7.png",
-    "BG.png",
-    TEXT_FILENAME(START),
-    TEXT_FILENAME(QUIT) 
+    "BG.png"
 };
 
+const char FONT_FILE[] = "OpenSans.ttf";
+const int FONT_SIZE = 16;
+
+// Baked blocks rendered into a target texture, redrawn a row at a time when GameState::rowVersion changes
+typedef struct BoardLayer {
+    SDL_Texture* texture = NULL;
+    // Contents are undefined until the first full redraw, or after the renderer loses its targets
+    bool valid = false;
+    // Render targets unsupported, draw the bake directly each frame
+    bool unsupported = false;
+    uint32 drawnVersion[PLAYAREA_HEIGHT];
+} BoardLayer;
+
 typedef struct Assets {
     SDL_Texture* textures[AssetType::COUNT];
     TTF_Font* font = NULL;
-} Assets;
-
-typedef int GameBlocks[PLAYAREA_HEIGHT][PLAYAREA_WIDTH];
 
-typedef struct GameState {
-    double timeSinceLastFall = 0;
-    double timePerFall = 1.0;
-    QuadBlock* currentBlock = NULL;
-    int blockBake[PLAYAREA_HEIGHT][PLAYAREA_WIDTH] = { { -1 } };
-    int horizMove = 0;
-    int rotate = 0;
+    // Every block type plus a plain white patch for highlights, in one texture
+    SDL_Texture* blockAtlas = NULL;
+    int blockAtlasWidth = 0;
+    int blockAtlasHeight = 0;
+    SDL_Rect blockRects[NUM_BLOCKTYPES];
+    SDL_Rect whiteRect;
+    SpriteBatch sprites;
 
-    bool wantsToQuit = false;
-    bool paused = false;
-    bool turbo = false;
-    
-    //Completed rows animation logic
-    double animating = 0;
-    int numCompleteRows = 0;
-    int completeRows[4] = { 0, 0, 0, 0 };
-    bool flashOn = false;
-    double flashAccumulator = 0;
+    GlyphAtlas glyphs;
 
-    const double flashSpeed = 1.0 / 20.0;
-    const double flashTime = 0.5;
-} GameState;
+    BoardLayer boardLayer;
+} Assets;
 
-void GameUpdateAndRender( SDL_Renderer* renderer, Assets* assets, GameState* gameState, double dtSeconds );
+// Draws a snapshot as of now, a performance counter reading, with the active piece between its last two positions
+void GameRender( SDL_Renderer* renderer, Assets* assets, const GameSnapshot* snapshot, Uint64 now );
 
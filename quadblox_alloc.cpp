@@ -0,0 +1,66 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "quadblox_alloc.h"
+
+// Constant-initialized, so counting works even for allocations made before main or while a thread starts up
+static thread_local uint64 threadAllocations = 0;
+static std::atomic<uint64> processAllocations( 0 );
+
+uint64 AllocationsOnThread() {
+    return threadAllocations;
+}
+
+uint64 AllocationsInProcess() {
+    return processAllocations.load( std::memory_order_relaxed );
+}
+
+static void* allocate( size_t size ) {
+    threadAllocations++;
+    processAllocations.fetch_add( 1, std::memory_order_relaxed );
+    return malloc( size ? size : 1 );
+}
+
+void* operator new( size_t size ) {
+    void* memory = allocate( size );
+    if ( memory == NULL ) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void* operator new[]( size_t size ) {
+    return operator new( size );
+}
+
+void* operator new( size_t size, const std::nothrow_t& ) noexcept {
+    return allocate( size );
+}
+
+void* operator new[]( size_t size, const std::nothrow_t& ) noexcept {
+    return allocate( size );
+}
+
+void operator delete( void* memory ) noexcept {
+    free( memory );
+}
+
+void operator delete[]( void* memory ) noexcept {
+    free( memory );
+}
+
+void operator delete( void* memory, size_t ) noexcept {
+    free( memory );
+}
+
+void operator delete[]( void* memory, size_t ) noexcept {
+    free( memory );
+}
+
+void operator delete( void* memory, const std::nothrow_t& ) noexcept {
+    free( memory );
+}
+
+void operator delete[]( void* memory, const std::nothrow_t& ) noexcept {
+    free( memory );
+}
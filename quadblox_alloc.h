@@ -0,0 +1,11 @@
+#pragma once
+#include "quadblox_engine.h"
+
+// Counts operator new calls per thread, so a loop can check that its steady state never touches the heap: read the
+// count before and after, and anything but zero is an allocation on that path. Linking this in replaces the global
+// operator new and delete for the whole program. Memory C libraries such as SDL take from malloc is not counted.
+
+// Every operator new on the calling thread so far
+uint64 AllocationsOnThread();
+// Every operator new on any thread so far, for loops that hand work to other threads
+uint64 AllocationsInProcess();
@@ -0,0 +1,295 @@
+#include <cstring>
+#include "quadblox_batch.h"
+
+#if ( defined(__x86_64__) || defined(__i386__) ) && defined(__GNUC__)
+#define QUADBLOX_BATCH_X86 1
+#include <immintrin.h>
+#endif
+
+// One kernel pass over boards [begin, end), begin a multiple of the kernel's width.
+// On the boards whose fall is due, falls every piece that can fall and bakes every piece that can't. Flags landed
+// boards and boards with full rows.
+typedef void (*BatchKernelFn)( uint16* rows, uint16* piece, const uint16* due, uint16* landed, uint16* full, int stride,
+                               int begin, int end );
+
+static void stepScalar( uint16* rows, uint16* piece, const uint16* due, uint16* landed, uint16* full, int stride, int begin,
+                        int end ) {
+    for ( int b = begin; b < end; b++ ) {
+        uint16 hit = piece[( PLAYAREA_HEIGHT - 1 ) * stride + b];
+        for ( int r = 0; r < PLAYAREA_HEIGHT - 1; r++ ) {
+            hit |= piece[r * stride + b] & rows[( r + 1 ) * stride + b];
+        }
+        uint16 land = hit ? due[b] : 0;
+        uint16 fall = hit ? 0 : due[b];
+
+        uint16 anyFull = 0;
+        for ( int r = PLAYAREA_HEIGHT - 1; r >= 0; r-- ) {
+            uint16 above = r > 0 ? piece[( r - 1 ) * stride + b] : 0;
+            uint16& row = rows[r * stride + b];
+            row |= piece[r * stride + b] & land;
+            piece[r * stride + b] = uint16( ( above & fall ) | ( piece[r * stride + b] & ~due[b] ) );
+            anyFull |= row == FULL_ROW ? 0xFFFF : 0;
+        }
+        landed[b] = land;
+        full[b] = anyFull;
+    }
+}
+
+#ifdef QUADBLOX_BATCH_X86
+
+__attribute__(( target( "sse2" ) ))
+static void stepSSE2( uint16* rows, uint16* piece, const uint16* due, uint16* landed, uint16* full, int stride, int begin,
+                      int end ) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i fullRow = _mm_set1_epi16( short( FULL_ROW ) );
+    for ( int b = begin; b < end; b += 8 ) {
+        __m128i hit = _mm_loadu_si128( (const __m128i*)&piece[( PLAYAREA_HEIGHT - 1 ) * stride + b] );
+        for ( int r = 0; r < PLAYAREA_HEIGHT - 1; r++ ) {
+            __m128i p = _mm_loadu_si128( (const __m128i*)&piece[r * stride + b] );
+            __m128i below = _mm_loadu_si128( (const __m128i*)&rows[( r + 1 ) * stride + b] );
+            hit = _mm_or_si128( hit, _mm_and_si128( p, below ) );
+        }
+        __m128i hitMask = _mm_xor_si128( _mm_cmpeq_epi16( hit, zero ), _mm_set1_epi16( -1 ) );
+        __m128i d = _mm_loadu_si128( (const __m128i*)&due[b] );
+        __m128i land = _mm_and_si128( hitMask, d );
+        __m128i fall = _mm_andnot_si128( hitMask, d );
+
+        __m128i anyFull = zero;
+        for ( int r = PLAYAREA_HEIGHT - 1; r >= 0; r-- ) {
+            __m128i above = r > 0 ? _mm_loadu_si128( (const __m128i*)&piece[( r - 1 ) * stride + b] ) : zero;
+            __m128i p = _mm_loadu_si128( (const __m128i*)&piece[r * stride + b] );
+            __m128i row = _mm_loadu_si128( (const __m128i*)&rows[r * stride + b] );
+            row = _mm_or_si128( row, _mm_and_si128( p, land ) );
+            _mm_storeu_si128( (__m128i*)&rows[r * stride + b], row );
+            _mm_storeu_si128( (__m128i*)&piece[r * stride + b], _mm_or_si128( _mm_and_si128( above, fall ), _mm_andnot_si128( d, p ) ) );
+            anyFull = _mm_or_si128( anyFull, _mm_cmpeq_epi16( row, fullRow ) );
+        }
+        _mm_storeu_si128( (__m128i*)&landed[b], land );
+        _mm_storeu_si128( (__m128i*)&full[b], anyFull );
+    }
+}
+
+__attribute__(( target( "avx2" ) ))
+static void stepAVX2( uint16* rows, uint16* piece, const uint16* due, uint16* landed, uint16* full, int stride, int begin,
+                      int end ) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i fullRow = _mm256_set1_epi16( short( FULL_ROW ) );
+    for ( int b = begin; b < end; b += 16 ) {
+        __m256i hit = _mm256_loadu_si256( (const __m256i*)&piece[( PLAYAREA_HEIGHT - 1 ) * stride + b] );
+        for ( int r = 0; r < PLAYAREA_HEIGHT - 1; r++ ) {
+            __m256i p = _mm256_loadu_si256( (const __m256i*)&piece[r * stride + b] );
+            __m256i below = _mm256_loadu_si256( (const __m256i*)&rows[( r + 1 ) * stride + b] );
+            hit = _mm256_or_si256( hit, _mm256_and_si256( p, below ) );
+        }
+        __m256i hitMask = _mm256_xor_si256( _mm256_cmpeq_epi16( hit, zero ), _mm256_set1_epi16( -1 ) );
+        __m256i d = _mm256_loadu_si256( (const __m256i*)&due[b] );
+        __m256i land = _mm256_and_si256( hitMask, d );
+        __m256i fall = _mm256_andnot_si256( hitMask, d );
+
+        __m256i anyFull = zero;
+        for ( int r = PLAYAREA_HEIGHT - 1; r >= 0; r-- ) {
+            __m256i above = r > 0 ? _mm256_loadu_si256( (const __m256i*)&piece[( r - 1 ) * stride + b] ) : zero;
+            __m256i p = _mm256_loadu_si256( (const __m256i*)&piece[r * stride + b] );
+            __m256i row = _mm256_loadu_si256( (const __m256i*)&rows[r * stride + b] );
+            row = _mm256_or_si256( row, _mm256_and_si256( p, land ) );
+            _mm256_storeu_si256( (__m256i*)&rows[r * stride + b], row );
+            _mm256_storeu_si256( (__m256i*)&piece[r * stride + b], _mm256_or_si256( _mm256_and_si256( above, fall ), _mm256_andnot_si256( d, p ) ) );
+            anyFull = _mm256_or_si256( anyFull, _mm256_cmpeq_epi16( row, fullRow ) );
+        }
+        _mm256_storeu_si256( (__m256i*)&landed[b], land );
+        _mm256_storeu_si256( (__m256i*)&full[b], anyFull );
+    }
+}
+
+#endif
+
+static const int KERNEL_WIDTH[BatchKernel::COUNT] = { 1, 1, 8, 16 };
+
+const char* BatchKernelName( BatchKernel::Enum kernel ) {
+    static const char* names[BatchKernel::COUNT] = { "auto", "scalar", "sse2", "avx2" };
+    return names[kernel];
+}
+
+bool BatchKernelSupported( BatchKernel::Enum kernel ) {
+    switch ( kernel ) {
+        case BatchKernel::AUTO:
+        case BatchKernel::SCALAR:
+            return true;
+#ifdef QUADBLOX_BATCH_X86
+        case BatchKernel::SSE2:
+            return __builtin_cpu_supports( "sse2" );
+        case BatchKernel::AVX2:
+            return __builtin_cpu_supports( "avx2" );
+#endif
+        default:
+            return false;
+    }
+}
+
+static BatchKernelFn kernelFunction( BatchKernel::Enum kernel ) {
+    switch ( kernel ) {
+#ifdef QUADBLOX_BATCH_X86
+        case BatchKernel::SSE2:
+            return stepSSE2;
+        case BatchKernel::AVX2:
+            return stepAVX2;
+#endif
+        default:
+            return stepScalar;
+    }
+}
+
+// Where the piece sits in board b's plane, as updateGame would leave it on the tick it spawns. Returns false if it
+// topped out, which updateGame decides before snapping the piece into the play area.
+static bool spawnPiece( BatchSim* sim, int b ) {
+    size_t i = size_t( b );
+    uint64* rng = &sim->rng[i];
+    if ( sim->nextBlockType[i] < 0 ) {
+        sim->nextBlockType[i] = int8( NextRandom( rng ) % NUM_BLOCKTYPES );
+    }
+    QuadBlock qb = RandomQuadBlock<PLAYAREA_WIDTH>( rng, sim->nextBlockType[i] );
+    sim->nextBlockType[i] = int8( NextRandom( rng ) % NUM_BLOCKTYPES );
+    sim->hasPiece[i] = 1;
+
+    const BlockOnBoard<PLAYAREA_WIDTH>& onBoard = OnBoard( qb );
+    int x = qb.x < onBoard.minX ? onBoard.minX : ( qb.x > onBoard.maxX ? onBoard.maxX : qb.x );
+    bool hits = false;
+    for ( int r = 0; r < 4; r++ ) {
+        int row = qb.y + r;
+        if ( row < 0 || row >= PLAYAREA_HEIGHT ) {
+            continue;
+        }
+        size_t index = size_t( row * sim->stride + b );
+        hits |= ( sim->rows[index] & BoardRowMask( qb, r, qb.x ) ) != 0;
+        sim->piece[index] = BoardRowMask( qb, r, x );
+    }
+    return !hits;
+}
+
+// Removes the same rows as the engine's BoardClearRows, compacting one strided column of the batch in a single pass
+static int clearFullRows( BatchSim* sim, int b ) {
+    uint16* rows = &sim->rows[size_t(b)];
+    int stride = sim->stride;
+    int write = PLAYAREA_HEIGHT - 1;
+    for ( int read = PLAYAREA_HEIGHT - 1; read >= 0; read-- ) {
+        if ( rows[read * stride] != FULL_ROW ) {
+            rows[write-- * stride] = rows[read * stride];
+        }
+    }
+    int cleared = write + 1;
+    for ( ; write >= 0; write-- ) {
+        rows[write * stride] = 0;
+    }
+    return cleared;
+}
+
+// As InitGame: the generator carries on
+static void resetBoard( BatchSim* sim, int b ) {
+    for ( int r = 0; r < PLAYAREA_HEIGHT; r++ ) {
+        sim->rows[size_t( r * sim->stride + b )] = 0;
+        sim->piece[size_t( r * sim->stride + b )] = 0;
+    }
+    size_t i = size_t( b );
+    sim->ticksSinceLastFall[i] = 0;
+    sim->animating[i] = 0;
+    sim->nextBlockType[i] = -1;
+    sim->hasPiece[i] = 0;
+}
+
+// Everything updateGame does with no input before the fall: the flash countdown, clearing rows once it ends, and
+// spawning. Returns whether board b's fall is due this tick, and flags it in due.
+static bool startTick( BatchSim* sim, int b ) {
+    size_t i = size_t( b );
+    sim->due[i] = 0;
+    sim->ticksSinceLastFall[i]++;
+    if ( sim->animating[i] > 0 ) {
+        if ( --sim->animating[i] > 0 ) {
+            return false;
+        }
+        sim->linesCleared += clearFullRows( sim, b );
+    }
+    if ( !sim->hasPiece[i] && !spawnPiece( sim, b ) ) {
+        resetBoard( sim, b );
+        sim->gamesFinished++;
+        return false;
+    }
+    if ( sim->ticksSinceLastFall[i] <= TICKS_PER_FALL ) {
+        return false;
+    }
+    sim->ticksSinceLastFall[i] = 0;
+    sim->due[i] = 0xFFFF;
+    return true;
+}
+
+bool BatchInit( BatchSim* sim, int numBoards, uint64 seed, BatchKernel::Enum kernel ) {
+    if ( kernel == BatchKernel::AUTO ) {
+        kernel = BatchKernelSupported( BatchKernel::AVX2 ) ? BatchKernel::AVX2
+            : ( BatchKernelSupported( BatchKernel::SSE2 ) ? BatchKernel::SSE2 : BatchKernel::SCALAR );
+    }
+    if ( !BatchKernelSupported( kernel ) ) {
+        return false;
+    }
+
+    sim->kernel = kernel;
+    sim->numBoards = numBoards;
+    sim->stride = ( numBoards + 15 ) & ~15;
+    size_t plane = size_t( PLAYAREA_HEIGHT * sim->stride );
+    size_t boards = size_t( sim->stride );
+    sim->rows.assign( plane, 0 );
+    sim->piece.assign( plane, 0 );
+    sim->due.assign( boards, 0 );
+    sim->landed.assign( boards, 0 );
+    sim->full.assign( boards, 0 );
+    sim->rng.resize( boards );
+    for ( size_t b = 0; b < boards; b++ ) {
+        sim->rng[b] = SeedRandom( seed + b );
+    }
+    sim->ticksSinceLastFall.assign( boards, 0 );
+    sim->animating.assign( boards, 0 );
+    sim->nextBlockType.assign( boards, -1 );
+    sim->hasPiece.assign( boards, 0 );
+    sim->ticks = 0;
+    sim->linesCleared = 0;
+    sim->gamesFinished = 0;
+    return true;
+}
+
+void BatchStep( BatchSim* sim, int numTicks ) {
+    BatchKernelFn step = kernelFunction( sim->kernel );
+    int width = KERNEL_WIDTH[sim->kernel];
+    int vectorEnd = sim->numBoards - sim->numBoards % width;
+
+    for ( int tick = 0; tick < numTicks; tick++ ) {
+        int numDue = 0;
+        for ( int b = 0; b < sim->numBoards; b++ ) {
+            numDue += startTick( sim, b ) ? 1 : 0;
+        }
+        sim->ticks++;
+        // Pieces fall once every TICKS_PER_FALL ticks, so most ticks have nothing for the kernel to do
+        if ( numDue == 0 ) {
+            continue;
+        }
+
+        step( &sim->rows[0], &sim->piece[0], &sim->due[0], &sim->landed[0], &sim->full[0], sim->stride, 0, vectorEnd );
+        stepScalar( &sim->rows[0], &sim->piece[0], &sim->due[0], &sim->landed[0], &sim->full[0], sim->stride, vectorEnd,
+                    sim->numBoards );
+
+        // Landings are rare next to falls, so the per-board follow-up stays scalar
+        for ( int b = 0; b < sim->numBoards; b++ ) {
+            if ( !sim->landed[size_t(b)] ) {
+                continue;
+            }
+            sim->hasPiece[size_t(b)] = 0;
+            if ( sim->full[size_t(b)] ) {
+                sim->animating[size_t(b)] = FLASH_DURATION_TICKS;
+            }
+        }
+    }
+}
+
+void BatchBoard( const BatchSim* sim, int b, uint16 outRows[PLAYAREA_HEIGHT], uint16 outPiece[PLAYAREA_HEIGHT] ) {
+    for ( int r = 0; r < PLAYAREA_HEIGHT; r++ ) {
+        outRows[r] = sim->rows[size_t( r * sim->stride + b )];
+        outPiece[r] = sim->piece[size_t( r * sim->stride + b )];
+    }
+}
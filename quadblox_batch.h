@@ -0,0 +1,56 @@
+#pragma once
+#include <vector>
+#include "quadblox_engine.h"
+
+// Lockstep simulator for many independent boards, for Monte Carlo rollouts.
+// Each board plays what GameStep plays with no input, from SeedGame( seed + board ): the piece falls every
+// TICKS_PER_FALL ticks, a landing that fills rows holds the board for the flash before clearing them, and spawns
+// draw type, rotation and column from the game's own generator. A board that tops out is emptied, as InitGame would,
+// and counted as a finished game. Only the flash itself is left out, since it never changes the board.
+//
+// Boards are stored structure-of-arrays: row r of every board is contiguous, so one vector register holds the same
+// row of 8 (SSE2) or 16 (AVX2) boards. The active piece lives in a second plane of the same shape, already shifted
+// into board coordinates, so collision, baking and full-row detection are plain row-wise AND/OR/compare.
+
+namespace BatchKernel {
+    enum Enum {
+        AUTO,
+        SCALAR,
+        SSE2,
+        AVX2,
+        COUNT
+    };
+}
+
+typedef struct BatchSim {
+    int numBoards = 0;
+    // Boards per row, numBoards rounded up to a whole AVX2 register
+    int stride = 0;
+    BatchKernel::Enum kernel = BatchKernel::SCALAR;
+
+    std::vector<uint16> rows;
+    std::vector<uint16> piece;
+    // 0xFFFF for boards whose piece falls this tick, whose piece landed, or that have a full row
+    std::vector<uint16> due;
+    std::vector<uint16> landed;
+    std::vector<uint16> full;
+
+    // Per board, as in BasicGameState
+    std::vector<uint64> rng;
+    std::vector<uint32> ticksSinceLastFall;
+    std::vector<uint32> animating;
+    std::vector<int8> nextBlockType;
+    std::vector<uint8> hasPiece;
+
+    long long ticks = 0;
+    long long linesCleared = 0;
+    long long gamesFinished = 0;
+} BatchSim;
+
+const char* BatchKernelName( BatchKernel::Enum kernel );
+bool BatchKernelSupported( BatchKernel::Enum kernel );
+// AUTO picks the widest kernel this CPU supports. Returns false if the requested kernel isn't supported.
+bool BatchInit( BatchSim* sim, int numBoards, uint64 seed, BatchKernel::Enum kernel );
+void BatchStep( BatchSim* sim, int numTicks );
+// Board b as it would be baked, and its piece as it would be baked where it stands, or 0 rows with no piece in play
+void BatchBoard( const BatchSim* sim, int b, uint16 outRows[PLAYAREA_HEIGHT], uint16 outPiece[PLAYAREA_HEIGHT] );
@@ -0,0 +1,279 @@
+#include <cstring>
+#include "quadblox_bot.h"
+#include "quadblox_threadpool.h"
+#include "quadblox_ttable.h"
+
+// Score given to a line of play that tops out
+const double BOT_TOPPED_OUT = -1e9;
+
+static void bakeRows( GameBlocks board, GameMetrics* metrics, const QuadBlock& qb ) {
+    for ( int i = 0; i < 4; i++ ) {
+        int row = qb.y + i;
+        uint16 mask = BoardRowMask( qb, i, qb.x );
+        if ( mask != 0 && row >= 0 && row < PLAYAREA_HEIGHT ) {
+            board[row] |= mask;
+            BoardMetricsAdd( metrics, row, mask );
+        }
+    }
+}
+
+// The cells a placed piece covers, packed so that two placements share a key exactly when they cover the same cells
+static uint64 cellsKey( const QuadBlock& qb ) {
+    uint64 key = 0;
+    int top = -1;
+    for ( int i = 0; i < 4; i++ ) {
+        uint64 mask = BoardRowMask( qb, i, qb.x );
+        if ( mask == 0 ) {
+            continue;
+        }
+        if ( top < 0 ) {
+            top = i;
+        }
+        key |= mask << ( 12 * ( i - top ) );
+    }
+    return key | uint64( qb.y + top + 8 ) << 48;
+}
+
+// Through the engine's own row clearing, so placements, and perft counting them, follow the game's rules
+static int clearFullRows( GameBlocks board, GameMetrics* metrics, const QuadBlock& qb ) {
+    int fullRows[4];
+    int numFull = 0;
+    findCompleteRows( *metrics, qb, fullRows, numFull );
+    BoardClearRows( board, metrics, fullRows, numFull );
+    return numFull;
+}
+
+int BotListPlacements( const GameBlocks board, uint64 boardHash, const GameMetrics& metrics, const QuadBlock& qb,
+                       BotPlacement outPlacements[BOT_MAX_PLACEMENTS] ) {
+    int numPlacements = 0;
+    uint16 seenStates[NUM_BLOCKSTATES];
+    int numSeen = 0;
+    uint64 placedCells[BOT_MAX_PLACEMENTS];
+
+    for ( int turns = 0; turns < NUM_BLOCKSTATES; turns++ ) {
+        QuadBlock rotated = qb;
+        RotateBlock( rotated, turns );
+
+        // Several rotations of the same piece can share a shape
+        bool seen = false;
+        for ( int i = 0; i < numSeen; i++ ) {
+            seen |= seenStates[i] == rotated.state;
+        }
+        if ( seen ) {
+            continue;
+        }
+        seenStates[numSeen++] = rotated.state;
+
+        int realBottom = PLAYAREA_HEIGHT - 4 + Bottom( rotated ) + 1;
+        if ( rotated.y >= realBottom - 1 ) {
+            rotated.y = realBottom - 1;
+        }
+
+        const BlockOnBoard<PLAYAREA_WIDTH>& b = OnBoard( rotated );
+        for ( int x = b.minX; x <= b.maxX; x++ ) {
+            QuadBlock moved = rotated;
+            moved.x = x;
+            if ( blockHitsBake( moved, board, 0, 0 ) ) {
+                continue;
+            }
+            while ( moved.y + 1 < realBottom && !blockHitsBake( moved, board, 1, 0 ) ) {
+                moved.y++;
+            }
+
+            // Shapes that differ only by an offset in the 4x4 grid (I, S, Z) land on the same cells from different x
+            uint64 cells = cellsKey( moved );
+            bool duplicate = false;
+            for ( int i = 0; i < numPlacements; i++ ) {
+                duplicate |= placedCells[i] == cells;
+            }
+            if ( duplicate ) {
+                continue;
+            }
+            placedCells[numPlacements] = cells;
+
+            BotPlacement& placement = outPlacements[numPlacements++];
+            placement.x = moved.x;
+            placement.y = moved.y;
+            placement.state = moved.currentState;
+            memcpy( placement.result, board, sizeof( GameBlocks ) );
+            placement.metrics = metrics;
+            bakeRows( placement.result, &placement.metrics, moved );
+            placement.linesCleared = clearFullRows( placement.result, &placement.metrics, moved );
+            if ( placement.linesCleared == 0 ) {
+                placement.hash = boardHash;
+                for ( int i = 0; i < 4; i++ ) {
+                    int row = moved.y + i;
+                    if ( row >= 0 && row < PLAYAREA_HEIGHT ) {
+                        placement.hash ^= ZobristRow( row, BoardRowMask( moved, i, moved.x ) );
+                    }
+                }
+            } else {
+                // Everything above the cleared rows moved down
+                placement.hash = BoardHash( placement.result );
+            }
+        }
+    }
+    return numPlacements;
+}
+
+double BotScoreBoard( const GameMetrics& metrics, int linesCleared, const BotWeights& weights ) {
+    return weights.aggregateHeight * metrics.aggregateHeight + weights.linesCleared * linesCleared
+        + weights.holes * metrics.holes + weights.bumpiness * metrics.bumpiness;
+}
+
+QuadBlock BotSpawnPosition( int blockType ) {
+    QuadBlock qb;
+    qb.blockType = blockType;
+    qb.currentState = 0;
+    RotateBlock( qb, 0 );
+    qb.x = PLAYAREA_WIDTH / 2 - 2;
+    qb.y = -Top( qb );
+    return qb;
+}
+
+// Everything a subtree's value depends on besides the weights: the board, the lines cleared on the way there, the
+// piece to place and every piece after it
+static uint64 searchKey( uint64 boardHash, int linesSoFar, int blockType, const int* upcoming, int numUpcoming ) {
+    uint64 key = boardHash ^ ( uint64( linesSoFar ) << 8 | uint64( blockType + 1 ) ) * 0x9E3779B97F4A7C15ull;
+    for ( int i = 0; i < numUpcoming; i++ ) {
+        key = ( key ^ uint64( upcoming[i] + 2 ) ) * 0xBF58476D1CE4E5B9ull;
+    }
+    key ^= uint64( numUpcoming ) * 0x94D049BB133111EBull;
+    return key ^ ( key >> 31 );
+}
+
+static double searchValue( const GameBlocks board, uint64 boardHash, const GameMetrics& metrics, int linesSoFar,
+                           const int* upcoming, int numUpcoming, const BotWeights& weights, TranspositionTable* table,
+                           long long& nodes );
+
+// Best value reachable by placing blockType, then the rest of the sequence
+static double searchPiece( const GameBlocks board, uint64 boardHash, const GameMetrics& metrics, int linesSoFar,
+                           int blockType, const int* upcoming, int numUpcoming, const BotWeights& weights,
+                           TranspositionTable* table, long long& nodes ) {
+    QuadBlock qb = BotSpawnPosition( blockType );
+    if ( blockHitsBake( qb, board, 0, 0 ) ) {
+        return BOT_TOPPED_OUT;
+    }
+
+    uint64 key = 0;
+    double best = BOT_TOPPED_OUT;
+    if ( table ) {
+        key = searchKey( boardHash, linesSoFar, blockType, upcoming, numUpcoming );
+        if ( table->Probe( key, &best ) ) {
+            return best;
+        }
+    }
+
+    BotPlacement placements[BOT_MAX_PLACEMENTS];
+    int numPlacements = BotListPlacements( board, boardHash, metrics, qb, placements );
+    for ( int i = 0; i < numPlacements; i++ ) {
+        double value = searchValue( placements[i].result, placements[i].hash, placements[i].metrics,
+                                    linesSoFar + placements[i].linesCleared, upcoming, numUpcoming, weights, table, nodes );
+        if ( value > best ) {
+            best = value;
+        }
+    }
+    if ( table ) {
+        table->Store( key, best );
+    }
+    return best;
+}
+
+static double searchValue( const GameBlocks board, uint64 boardHash, const GameMetrics& metrics, int linesSoFar,
+                           const int* upcoming, int numUpcoming, const BotWeights& weights, TranspositionTable* table,
+                           long long& nodes ) {
+    nodes++;
+    if ( numUpcoming == 0 ) {
+        return BotScoreBoard( metrics, linesSoFar, weights );
+    }
+    if ( upcoming[0] >= 0 ) {
+        return searchPiece( board, boardHash, metrics, linesSoFar, upcoming[0], upcoming + 1, numUpcoming - 1, weights,
+                            table, nodes );
+    }
+
+    // Unknown piece: average over every type it could be
+    double total = 0;
+    for ( int blockType = 0; blockType < NUM_BLOCKTYPES; blockType++ ) {
+        total += searchPiece( board, boardHash, metrics, linesSoFar, blockType, upcoming + 1, numUpcoming - 1, weights,
+                              table, nodes );
+    }
+    return total / NUM_BLOCKTYPES;
+}
+
+// One root placement's subtree, searched as one pool task
+typedef struct BotSearchTask {
+    const BotPlacement* placement;
+    const int* upcoming;
+    int numUpcoming;
+    const BotWeights* weights;
+    TranspositionTable* table;
+    double value;
+    long long nodes;
+} BotSearchTask;
+
+static void runSearchTask( void* arg ) {
+    BotSearchTask* task = (BotSearchTask*)arg;
+    const BotPlacement* placement = task->placement;
+    // Counted locally, so tasks on neighbouring threads don't keep writing to the same cache line
+    long long nodes = 0;
+    task->value = searchValue( placement->result, placement->hash, placement->metrics, placement->linesCleared,
+                               task->upcoming, task->numUpcoming, *task->weights, task->table, nodes );
+    task->nodes = nodes;
+}
+
+BotSearchResult BotSearch( const GameBlocks board, uint64 boardHash, const GameMetrics& metrics, const QuadBlock& qb,
+                           const int* upcoming, int numUpcoming, const BotWeights& weights, ThreadPool* pool,
+                           TranspositionTable* table ) {
+    BotSearchResult result;
+    BotPlacement placements[BOT_MAX_PLACEMENTS];
+    int numPlacements = BotListPlacements( board, boardHash, metrics, qb, placements );
+    if ( numPlacements == 0 ) {
+        return result;
+    }
+
+    BotSearchTask tasks[BOT_MAX_PLACEMENTS];
+    for ( int i = 0; i < numPlacements; i++ ) {
+        BotSearchTask* task = &tasks[i];
+        task->placement = &placements[i];
+        task->upcoming = upcoming;
+        task->numUpcoming = numUpcoming;
+        task->weights = &weights;
+        task->table = table;
+        if ( pool ) {
+            pool->Submit( runSearchTask, task );
+        } else {
+            runSearchTask( task );
+        }
+    }
+    if ( pool ) {
+        pool->Wait();
+    }
+
+    int best = 0;
+    for ( int i = 0; i < numPlacements; i++ ) {
+        result.nodes += tasks[i].nodes;
+        if ( tasks[i].value > tasks[best].value ) {
+            best = i;
+        }
+    }
+    result.found = true;
+    result.placement = placements[best];
+    result.score = tasks[best].value;
+    return result;
+}
+
+GameInput BotInputToward( const GameState* gameState, const BotPlacement& target ) {
+    GameInput input;
+    if ( !gameState->hasCurrentBlock ) {
+        return input;
+    }
+    const QuadBlock& qb = gameState->currentBlock;
+    if ( qb.state != BLOCKS[qb.blockType][target.state] ) {
+        input.rotate = ( target.state - qb.currentState + NUM_BLOCKSTATES ) % NUM_BLOCKSTATES;
+    } else if ( qb.x != target.x ) {
+        input.horizMove = target.x - qb.x;
+    } else if ( !gameState->turbo ) {
+        input.turboOn = true;
+    }
+    return input;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "quadblox_engine.h"
+
+class ThreadPool;
+class TranspositionTable;
+
+// Upper bound on final placements for one piece: every rotation at every x it can occupy
+const int BOT_MAX_PLACEMENTS = NUM_BLOCKSTATES * ( PLAYAREA_WIDTH + 3 );
+
+// Linear board evaluation. Positive weights reward, negative weights penalize.
+typedef struct BotWeights {
+    double aggregateHeight = -0.51;
+    double linesCleared = 0.76;
+    double holes = -0.36;
+    double bumpiness = -0.18;
+} BotWeights;
+
+// Where a piece comes to rest, and the board that results
+typedef struct BotPlacement {
+    int x;
+    int y;
+    int state;
+    int linesCleared;
+    GameBlocks result;
+    // Zobrist hash of result
+    uint64 hash;
+    GameMetrics metrics;
+} BotPlacement;
+
+typedef struct BotSearchResult {
+    bool found = false;
+    BotPlacement placement;
+    double score = 0;
+    long long nodes = 0;
+} BotSearchResult;
+
+// Every distinct final resting place of qb: each rotation, shifted to each legal x at its current height, then dropped.
+// Follows updateGame's rules: rotation snaps into the play area, a horizontal move only needs a free destination.
+// Result hashes and metrics are updated from boardHash and metrics, which describe board.
+int BotListPlacements( const GameBlocks board, uint64 boardHash, const GameMetrics& metrics, const QuadBlock& qb,
+                       BotPlacement outPlacements[BOT_MAX_PLACEMENTS] );
+// Piece as SpawnQuadBlock would place it, minus the random rotation and column. Every placement is reachable from
+// here, since BotListPlacements tries each rotation and column anyway.
+QuadBlock BotSpawnPosition( int blockType );
+double BotScoreBoard( const GameMetrics& metrics, int linesCleared, const BotWeights& weights );
+
+// Best placement for qb, looking ahead through the upcoming piece types. A type of -1 is an unknown piece, scored as
+// the average over all types. Root placements are searched as separate tasks on the pool; with no pool the search
+// runs on the calling thread. With a table, subtree values are cached across move orders, root placements and
+// calls; a table must only ever see one set of weights.
+BotSearchResult BotSearch( const GameBlocks board, uint64 boardHash, const GameMetrics& metrics, const QuadBlock& qb,
+                           const int* upcoming, int numUpcoming, const BotWeights& weights, ThreadPool* pool,
+                           TranspositionTable* table );
+
+// Input for the next tick that moves the current piece toward target: rotate first, then shift, then drop.
+GameInput BotInputToward( const GameState* gameState, const BotPlacement& target );
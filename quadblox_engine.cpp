@@ -0,0 +1,602 @@
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include "stdlib.h"
+#include "quadblox_engine.h"
+
+// Draw each state of each block in a 4x4 grid, represent each grid as a 16-bit int. 1 is square, 0 is no square.
+// This is the only piece definition; everything else about the pieces is derived from it at compile time.
+constexpr uint16_t BLOCKS[NUM_BLOCKTYPES][NUM_BLOCKSTATES] = {
+    {0x08E0, 0x0644, 0x00E2, 0x044C}, //Reverse L
+    {0x02E0, 0x0446, 0x00E8, 0x0C44}, //L
+    {0x06C0, 0x0462, 0x006C, 0x08C4}, //S
+    {0x00C6, 0x04C8, 0x0C60, 0x0264}, //Z
+    {0x0660, 0x0660, 0x0660, 0x0660}, //Square
+    {0x04C4, 0x04E0, 0x0464, 0x00E4}, //T
+    {0x4444, 0x0F00, 0x2222, 0x00F0} //Line
+};
+
+static constexpr BlockGeometry buildGeometry( uint16 state ) {
+    BlockGeometry g = {};
+    for ( int i = 0; i < 4; i++ ) {
+        g.rows[i] = uint8( 0xF & ( state >> ( 4 * ( 4 - i - 1 ) ) ) );
+        g.cols = uint8( g.cols | g.rows[i] );
+    }
+    while ( g.left < 4 && ( ( g.cols >> ( 3 - g.left ) ) & 1 ) == 0 ) g.left++;
+    while ( g.right < 4 && ( ( g.cols >> g.right ) & 1 ) == 0 ) g.right++;
+    while ( g.top < 4 && g.rows[g.top] == 0 ) g.top++;
+    while ( g.bottom < 4 && g.rows[3 - g.bottom] == 0 ) g.bottom++;
+    return g;
+}
+
+static constexpr BlockGeometryTable buildGeometryTable() {
+    BlockGeometryTable table = {};
+    for ( int type = 0; type < NUM_BLOCKTYPES; type++ ) {
+        for ( int state = 0; state < NUM_BLOCKSTATES; state++ ) {
+            table.blocks[type][state] = buildGeometry( BLOCKS[type][state] );
+        }
+    }
+    return table;
+}
+
+constexpr BlockGeometryTable BLOCK_GEOMETRY = buildGeometryTable();
+
+template <int W>
+static constexpr BoardGeometry<W> buildBoardGeometry() {
+    BoardGeometry<W> table = {};
+    for ( int type = 0; type < NUM_BLOCKTYPES; type++ ) {
+        for ( int state = 0; state < NUM_BLOCKSTATES; state++ ) {
+            const BlockGeometry& g = BLOCK_GEOMETRY.blocks[type][state];
+            BlockOnBoard<W>& b = table.blocks[type][state];
+            b.minX = int8( -g.left );
+            b.maxX = int8( W - 4 + g.right );
+            for ( int x = BOARD_MASK_MIN_X; x <= W + 3; x++ ) {
+                // Shifting a 64-bit row by 64 or more is undefined, and leaves nothing on the board anyway
+                int shift = W - 4 - x;
+                for ( int i = 0; i < 4; i++ ) {
+                    uint64 row = shift >= 64 ? 0 : ( shift >= 0 ? uint64( g.rows[i] ) << shift : uint64( g.rows[i] ) >> -shift );
+                    b.boardRows[x - BOARD_MASK_MIN_X][i] = BoardRow<W>( row & FullRow<W>() );
+                }
+            }
+        }
+    }
+    return table;
+}
+
+template <int W>
+const BoardGeometry<W> BoardGeometry<W>::table = buildBoardGeometry<W>();
+
+static constexpr bool allBlocksHaveFourCells() {
+    for ( int type = 0; type < NUM_BLOCKTYPES; type++ ) {
+        for ( int state = 0; state < NUM_BLOCKSTATES; state++ ) {
+            int cells = 0;
+            for ( uint16 bits = BLOCKS[type][state]; bits; bits = uint16( bits & ( bits - 1 ) ) ) cells++;
+            if ( cells != 4 ) return false;
+        }
+    }
+    return true;
+}
+static_assert( allBlocksHaveFourCells(), "every block state must have exactly four squares" );
+static_assert( BLOCK_GEOMETRY.blocks[6][0].left == 1 && BLOCK_GEOMETRY.blocks[6][0].right == 2, "line extents" );
+static_assert( buildBoardGeometry<HUGE_WIDTH>().blocks[6][1].boardRows[0 - BOARD_MASK_MIN_X][1] == 0xF000000000000000ull,
+               "flat line at x 0 fills the four highest columns" );
+
+void RotateBlock(QuadBlock& qb, int numTimes) {
+    qb.currentState = ( qb.currentState + numTimes ) % NUM_BLOCKSTATES;
+    qb.state = BLOCKS[qb.blockType][qb.currentState];
+}
+
+template <int W, int H>
+QuadBlock SpawnQuadBlock( BasicGameState<W, H>* gameState, int blockType ) {
+    return RandomQuadBlock<W>( &gameState->rngState, blockType );
+}
+
+template <int W>
+QuadBlock RandomQuadBlock( uint64* rngState, int blockType ) {
+    QuadBlock qb;
+    qb.currentState = int( NextRandom( rngState ) % NUM_BLOCKSTATES );
+    qb.blockType = blockType;
+    qb.state = BLOCKS[qb.blockType][qb.currentState];
+
+    //Fit to top, in case of empty-top
+    const BlockGeometry& g = Geometry(qb);
+    qb.y = -g.top;
+    qb.x = int( NextRandom( rngState ) % uint32( W + g.left + g.right ) ) + OnBoard<W>(qb).minX;
+    return qb;
+}
+
+
+template <int W, int H>
+static void printBake( const int8 bake[H][W] ) {
+    for ( int i = 0; i < H; i++ ) {
+        for ( int j = 0; j < W; j++ ) {
+            printf( "%02d ", bake[i][j] );    
+        }
+        printf("\n");
+    }
+    printf("\n\n");
+}
+
+template <int W, int H>
+void bakeBlock( BasicGameState<W, H>* gameState, const QuadBlock* qb ) {
+    for ( int i = 0; i < 4; i++ ) {
+        int row = i + qb->y;
+        BoardRow<W> mask = BoardRowMask<W>( *qb, i, qb->x );
+        if ( mask == 0 || row < 0 || row >= H ) {
+            continue;
+        }
+        // Rotation can push a piece into baked cells, so only account for the cells that are new
+        BoardRow<W> added = BoardRow<W>( mask & ~gameState->blockBake[row] );
+        gameState->boardHash ^= ZobristRow<W>( row, added );
+        BoardMetricsAdd( &gameState->metrics, row, added );
+        gameState->blockBake[row] |= mask;
+        for ( int col = 0; col < W; col++ ) {
+            if ( ( mask >> ( W - col - 1 ) ) & 1 ) {
+                gameState->blockColor[row][col] = int8(qb->blockType);
+            }
+        }
+        gameState->rowVersion[row]++;
+    }
+}
+
+template <int W, int H>
+bool blockHitsBake( const QuadBlock& qb, const BoardRow<W>* blockBake, const int verticalLookahead, const int horizLookahead ) {
+    int x = qb.x + horizLookahead;
+    for ( int i = 0; i < 4; i++ ) {
+        int row = i + qb.y + verticalLookahead;
+        if ( row >= 0 && row < H && ( blockBake[row] & BoardRowMask<W>( qb, i, x ) ) ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <int W, int H>
+void findCompleteRows( const BoardMetrics<W, H>& metrics, const QuadBlock& qb, int outRows[4], int& outNumRows ) {
+    outNumRows = 0;
+    for ( int i = 0; i < 4; i++ ) {
+        int row = qb.y + i;
+        if ( row >= 0 && row < H && metrics.rowFill[row] == W ) {
+            outRows[outNumRows] = row;
+            outNumRows++;
+        }
+    }
+}
+
+static int heightStep( int a, int b ) {
+    return a > b ? a - b : b - a;
+}
+
+template <int W, int H>
+void BoardMetricsAdd( BoardMetrics<W, H>* metrics, int row, BoardRow<W> cells ) {
+    int height = H - row;
+    uint64 remaining = cells;
+    while ( remaining != 0 ) {
+        int col = W - 1 - __builtin_ctzll( remaining );
+        remaining &= remaining - 1;
+        metrics->rowFill[row]++;
+        metrics->filledCells++;
+
+        int old = metrics->columnHeight[col];
+        if ( height <= old ) {
+            continue;
+        }
+        metrics->columnHeight[col] = uint8( height );
+        metrics->aggregateHeight += height - old;
+        if ( col > 0 ) {
+            int left = metrics->columnHeight[col - 1];
+            metrics->bumpiness += heightStep( height, left ) - heightStep( old, left );
+        }
+        if ( col < W - 1 ) {
+            int right = metrics->columnHeight[col + 1];
+            metrics->bumpiness += heightStep( height, right ) - heightStep( old, right );
+        }
+        if ( height > metrics->maxHeight ) {
+            metrics->maxHeight = height;
+        }
+    }
+    metrics->holes = metrics->aggregateHeight - metrics->filledCells;
+}
+
+template <int W, int H>
+void BoardMetricsClearRows( BoardMetrics<W, H>* metrics, const BoardRow<W>* rows, const int* clearedRows, int numRows ) {
+    if ( numRows == 0 ) {
+        return;
+    }
+    int write = H - 1;
+    int nextCleared = numRows - 1;
+    for ( int read = H - 1; read >= 0; read-- ) {
+        if ( nextCleared >= 0 && read == clearedRows[nextCleared] ) {
+            nextCleared--;
+            continue;
+        }
+        metrics->rowFill[write--] = metrics->rowFill[read];
+    }
+    for ( ; write >= 0; write-- ) {
+        metrics->rowFill[write] = 0;
+    }
+    metrics->filledCells -= numRows * W;
+
+    // A full row reaches every column, so every column loses exactly the cleared rows, except that a column whose
+    // top cell was in the highest of them has to look for its new top
+    int highestCleared = H - clearedRows[0];
+    metrics->aggregateHeight = 0;
+    metrics->maxHeight = 0;
+    for ( int col = 0; col < W; col++ ) {
+        int height = metrics->columnHeight[col];
+        if ( height > highestCleared ) {
+            height -= numRows;
+        } else {
+            BoardRow<W> bit = BoardRow<W>( BoardRow<W>( 1 ) << ( W - col - 1 ) );
+            int row = H - ( highestCleared - numRows );
+            while ( row < H && !( rows[row] & bit ) ) {
+                row++;
+            }
+            height = H - row;
+        }
+        metrics->columnHeight[col] = uint8( height );
+        metrics->aggregateHeight += height;
+        if ( height > metrics->maxHeight ) {
+            metrics->maxHeight = height;
+        }
+    }
+    metrics->bumpiness = 0;
+    for ( int col = 0; col < W - 1; col++ ) {
+        metrics->bumpiness += heightStep( metrics->columnHeight[col], metrics->columnHeight[col + 1] );
+    }
+    metrics->holes = metrics->aggregateHeight - metrics->filledCells;
+}
+
+template <int W, int H>
+void BoardMetricsFromRows( BoardMetrics<W, H>* metrics, const BoardRow<W>* rows ) {
+    *metrics = BoardMetrics<W, H>();
+    for ( int row = 0; row < H; row++ ) {
+        BoardMetricsAdd( metrics, row, rows[row] );
+    }
+}
+
+template <int W, int H>
+void ClearRow(BasicGameState<W, H>* gameState, int row) {
+    gameState->rowVersion[row]++;
+    gameState->boardHash ^= ZobristRow<W>( row, gameState->blockBake[row] );
+    gameState->blockBake[row] = 0;
+    for ( int i = 0; i < W; i++ ) {
+        gameState->blockColor[row][i] = -1;
+    }
+}
+
+// Each run of rows between two cleared ones moves straight to its final place, down by the cleared rows below it.
+// Going bottom up, no run lands on rows that have not moved yet. The freed rows at the top are filled with fill.
+template <typename Row>
+static void removeRows( Row* rows, const int* cleared, int numRows, int fill ) {
+    for ( int i = numRows - 1; i >= 0; i-- ) {
+        int top = i > 0 ? cleared[i - 1] + 1 : 0;
+        int count = cleared[i] - top;
+        int shift = numRows - i;
+        if ( count > 0 ) {
+            memmove( &rows[top + shift], &rows[top], sizeof( Row ) * size_t( count ) );
+        }
+    }
+    memset( rows, fill, sizeof( Row ) * size_t( numRows ) );
+}
+
+template <int W, int H>
+void BoardClearRows( BoardRow<W>* rows, BoardMetrics<W, H>* metrics, const int* clearedRows, int numRows ) {
+    if ( numRows <= 0 ) {
+        return;
+    }
+    removeRows( rows, clearedRows, numRows, 0 );
+    BoardMetricsClearRows( metrics, rows, clearedRows, numRows );
+}
+
+template <int W, int H>
+void ClearCompletedRows( BasicGameState<W, H>* gameState ) {
+    // findCompleteRows lists the rows top to bottom
+    const int* cleared = gameState->completeRows;
+    int numRows = gameState->numCompleteRows;
+    if ( numRows <= 0 ) {
+        return;
+    }
+
+    // Rows below the lowest cleared one stay put. Everything from there up is rehashed once, rather than per move.
+    int lowest = cleared[numRows - 1];
+    for ( int row = 0; row <= lowest; row++ ) {
+        gameState->boardHash ^= ZobristRow<W>( row, gameState->blockBake[row] );
+    }
+
+    BoardClearRows( gameState->blockBake, &gameState->metrics, cleared, numRows );
+    removeRows( gameState->blockColor, cleared, numRows, -1 );
+
+    for ( int row = 0; row <= lowest; row++ ) {
+        gameState->boardHash ^= ZobristRow<W>( row, gameState->blockBake[row] );
+        gameState->rowVersion[row]++;
+    }
+    gameState->linesCleared += numRows;
+}
+
+template <int W, int H>
+static uint32 fallTicks( const BasicGameState<W, H>* gameState ) {
+    return gameState->turbo ? gameState->ticksPerFall / TURBOFACTOR : gameState->ticksPerFall;
+}
+
+template <int W, int H>
+void updateGame( BasicGameState<W, H>* gameState ) {
+    if ( gameState->paused || gameState->gameOver ) {
+        return;
+    }
+
+    //Update PlayArea state ( completed row flashing )
+    gameState->ticksSinceLastFall++;
+    if ( gameState->animating > 0 ) {
+        gameState->flashAccumulator++;
+        gameState->animating--;
+        if ( gameState->flashAccumulator > FLASH_TOGGLE_TICKS ) {
+            gameState->flashOn = !gameState->flashOn;
+            gameState->flashAccumulator -= FLASH_TOGGLE_TICKS;
+        }
+        if ( gameState->animating == 0 ) {
+            gameState->flashOn = false;
+            gameState->flashAccumulator = 0;
+        } else {
+            return;
+        }
+    }
+
+    if ( gameState->numCompleteRows > 0 ) {
+        ClearCompletedRows(gameState);
+        gameState->numCompleteRows = 0;
+    }
+
+    if ( !gameState->hasCurrentBlock ) {
+        if ( gameState->nextBlockType < 0 ) {
+            gameState->nextBlockType = int( GameRandom( gameState ) % NUM_BLOCKTYPES );
+        }
+        gameState->currentBlock = SpawnQuadBlock( gameState, gameState->nextBlockType );
+        gameState->hasCurrentBlock = true;
+        gameState->nextBlockType = int( GameRandom( gameState ) % NUM_BLOCKTYPES );
+        // Topped out: the new piece has nowhere to go
+        if ( blockHitsBake<W, H>( gameState->currentBlock, gameState->blockBake, 0, 0 ) ) {
+            gameState->gameOver = true;
+            return;
+        }
+    }
+
+    //Update block state
+    QuadBlock& qb = gameState->currentBlock;
+
+    // Horizontal motion
+    if ( !blockHitsBake<W, H>( qb, gameState->blockBake, 0, gameState->horizMove ) ) {
+        qb.x += gameState->horizMove;
+    }
+    gameState->horizMove = 0;
+
+    //Rotation
+    //TODO(ebk): rotation can put us through other blocks. 
+    //Maybe accumulate all changes into one final state, and then reject or reconcile that state based on collision
+    RotateBlock(qb, gameState->rotate);
+    gameState->rotate = 0;
+
+    int realBottom = H - 4 + Bottom(qb) + 1;
+    // Rotation can put our asses through the floor
+    if ( qb.y >= realBottom - 1 ) {
+        qb.y = realBottom - 1;
+    }
+
+    //Snap into playarea
+    const BlockOnBoard<W>& b = OnBoard<W>(qb);
+    if ( qb.x <= b.minX ) qb.x = b.minX;
+    if ( qb.x >= b.maxX ) qb.x = b.maxX;
+
+    // Vertical Motion
+    uint32 ticksPerFall = fallTicks( gameState );
+    if ( gameState->ticksSinceLastFall > ticksPerFall ) {
+        //TODO: this is not fully correct. BUT, we don't want accumulated time from a full-length fall to cause multiple blocks fallage in a row
+        gameState->ticksSinceLastFall = 0;
+
+        int newY = qb.y + 1;
+        if ( newY >= realBottom || blockHitsBake<W, H>( qb, gameState->blockBake, 1, 0 ) ) {
+            bakeBlock( gameState, &gameState->currentBlock );
+            gameState->hasCurrentBlock = false;
+
+            findCompleteRows( gameState->metrics, gameState->currentBlock, gameState->completeRows, gameState->numCompleteRows );
+            if ( gameState->numCompleteRows > 0 ) {
+                gameState->animating = FLASH_DURATION_TICKS;
+            }
+
+            gameState->turbo = false;
+        } else {
+            qb.y = newY;
+        }
+    }
+}
+
+uint64 SeedRandom( uint64 seed ) {
+    // splitmix64, so that nearby seeds give unrelated streams
+    uint64 z = seed + 0x9E3779B97F4A7C15ull;
+    z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+    z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBull;
+    z = z ^ ( z >> 31 );
+    // xorshift must not start at zero
+    return z ? z : 1;
+}
+
+uint32 NextRandom( uint64* state ) {
+    // xorshift64*
+    uint64 x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return uint32( ( x * 0x2545F4914F6CDD1Dull ) >> 32 );
+}
+
+template <int W, int H>
+void SeedGame( BasicGameState<W, H>* gameState, uint64 seed ) {
+    gameState->rngState = SeedRandom( seed );
+    gameState->tick = 0;
+}
+
+template <int W, int H>
+uint32 GameRandom( BasicGameState<W, H>* gameState ) {
+    return NextRandom( &gameState->rngState );
+}
+
+template <int W, int H>
+void InitGame( BasicGameState<W, H>* gameState ) {
+    gameState->hasCurrentBlock = false;
+    gameState->nextBlockType = -1;
+    for ( int i = 0; i < H; i++ ) {
+        ClearRow( gameState, i );
+    }
+    gameState->metrics = BoardMetrics<W, H>();
+    gameState->ticksSinceLastFall = 0;
+    gameState->horizMove = 0;
+    gameState->rotate = 0;
+    gameState->linesCleared = 0;
+    gameState->turbo = false;
+    gameState->gameOver = false;
+    gameState->animating = 0;
+    gameState->numCompleteRows = 0;
+    gameState->flashOn = false;
+    gameState->flashAccumulator = 0;
+}
+
+template <int W, int H>
+void ApplyInput( BasicGameState<W, H>* gameState, const GameInput& input ) {
+    gameState->horizMove += input.horizMove;
+    gameState->rotate += input.rotate;
+    if ( input.turboOn ) {
+        gameState->turbo = true;
+    }
+    if ( input.turboOff ) {
+        gameState->turbo = false;
+    }
+    if ( input.togglePause ) {
+        gameState->paused = !gameState->paused;
+    }
+    if ( input.quit ) {
+        gameState->wantsToQuit = true;
+    }
+}
+
+template <int W, int H>
+void GameStep( BasicGameState<W, H>* gameState, const GameInput& input ) {
+    ApplyInput( gameState, input );
+    updateGame( gameState );
+    gameState->tick++;
+}
+
+template <int W, int H>
+uint32 GameTicksUntilEvent( const BasicGameState<W, H>* gameState ) {
+    if ( gameState->paused || gameState->gameOver ) {
+        return NO_EVENT;
+    }
+    // Input still waiting to be consumed
+    if ( gameState->horizMove != 0 || gameState->rotate != 0 ) {
+        return 0;
+    }
+
+    if ( gameState->animating > 0 ) {
+        // The tick that ends the animation, or that toggles the flash, is not idle
+        uint32 untilEnd = gameState->animating - 1;
+        uint32 untilToggle = gameState->flashAccumulator < FLASH_TOGGLE_TICKS ? FLASH_TOGGLE_TICKS - gameState->flashAccumulator : 0;
+        return untilEnd < untilToggle ? untilEnd : untilToggle;
+    }
+
+    // Row clears and spawns happen on the very next tick
+    if ( gameState->numCompleteRows > 0 || !gameState->hasCurrentBlock ) {
+        return 0;
+    }
+
+    // Moves, rotation and snapping are settled after any tick with the piece in play, so only the fall is left
+    uint32 ticksPerFall = fallTicks( gameState );
+    return gameState->ticksSinceLastFall < ticksPerFall ? ticksPerFall - gameState->ticksSinceLastFall : 0;
+}
+
+template <int W, int H>
+void GameSkipTicks( BasicGameState<W, H>* gameState, uint32 numTicks ) {
+    gameState->tick += numTicks;
+    if ( gameState->paused || gameState->gameOver ) {
+        return;
+    }
+    gameState->ticksSinceLastFall += numTicks;
+    if ( gameState->animating > 0 ) {
+        gameState->flashAccumulator += numTicks;
+        gameState->animating -= numTicks;
+    }
+}
+
+template <int W, int H>
+void GameAdvance( BasicGameState<W, H>* gameState, uint32 numTicks ) {
+    GameInput none;
+    while ( numTicks > 0 ) {
+        uint32 idle = GameTicksUntilEvent( gameState );
+        if ( idle > numTicks ) {
+            idle = numTicks;
+        }
+        GameSkipTicks( gameState, idle );
+        numTicks -= idle;
+        if ( numTicks > 0 ) {
+            GameStep( gameState, none );
+            numTicks--;
+        }
+    }
+}
+
+static uint64 hashBytes( uint64 hash, const void* data, size_t size ) {
+    // FNV-1a
+    const uint8* bytes = (const uint8*)data;
+    for ( size_t i = 0; i < size; i++ ) {
+        hash = ( hash ^ bytes[i] ) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+template <int W, int H>
+uint64 GameChecksum( const BasicGameState<W, H>* gameState ) {
+    uint64 hash = 0xCBF29CE484222325ull;
+    hash = hashBytes( hash, &gameState->tick, sizeof( gameState->tick ) );
+    hash = hashBytes( hash, &gameState->rngState, sizeof( gameState->rngState ) );
+    hash = hashBytes( hash, gameState->blockBake, sizeof( gameState->blockBake ) );
+    hash = hashBytes( hash, gameState->blockColor, sizeof( gameState->blockColor ) );
+    hash = hashBytes( hash, &gameState->linesCleared, sizeof( gameState->linesCleared ) );
+    hash = hashBytes( hash, &gameState->nextBlockType, sizeof( gameState->nextBlockType ) );
+    uint32 timers[6] = { gameState->ticksSinceLastFall, gameState->animating, gameState->flashAccumulator,
+                         gameState->flashOn, gameState->turbo, gameState->paused };
+    hash = hashBytes( hash, timers, sizeof( timers ) );
+    if ( gameState->hasCurrentBlock ) {
+        const QuadBlock& qb = gameState->currentBlock;
+        int piece[4] = { qb.x, qb.y, qb.blockType, qb.currentState };
+        hash = hashBytes( hash, piece, sizeof( piece ) );
+    }
+    return hash;
+}
+
+#define INSTANTIATE_ENGINE( W, H ) \
+    template QuadBlock SpawnQuadBlock( BasicGameState<W, H>* gameState, int blockType ); \
+    template QuadBlock RandomQuadBlock<W>( uint64* rngState, int blockType ); \
+    template void bakeBlock( BasicGameState<W, H>* gameState, const QuadBlock* qb ); \
+    template bool blockHitsBake<W, H>( const QuadBlock& qb, const BoardRow<W>* blockBake, const int verticalLookahead, const int horizLookahead ); \
+    template void findCompleteRows( const BoardMetrics<W, H>& metrics, const QuadBlock& qb, int outRows[4], int& outNumRows ); \
+    template void BoardMetricsAdd( BoardMetrics<W, H>* metrics, int row, BoardRow<W> cells ); \
+    template void BoardMetricsClearRows( BoardMetrics<W, H>* metrics, const BoardRow<W>* rows, const int* clearedRows, int numRows ); \
+    template void BoardMetricsFromRows( BoardMetrics<W, H>* metrics, const BoardRow<W>* rows ); \
+    template void ClearCompletedRows( BasicGameState<W, H>* gameState ); \
+    template void BoardClearRows( BoardRow<W>* rows, BoardMetrics<W, H>* metrics, const int* clearedRows, int numRows ); \
+    template void updateGame( BasicGameState<W, H>* gameState ); \
+    template void SeedGame( BasicGameState<W, H>* gameState, uint64 seed ); \
+    template uint32 GameRandom( BasicGameState<W, H>* gameState ); \
+    template void InitGame( BasicGameState<W, H>* gameState ); \
+    template void ApplyInput( BasicGameState<W, H>* gameState, const GameInput& input ); \
+    template void GameStep( BasicGameState<W, H>* gameState, const GameInput& input ); \
+    template uint32 GameTicksUntilEvent( const BasicGameState<W, H>* gameState ); \
+    template void GameSkipTicks( BasicGameState<W, H>* gameState, uint32 numTicks ); \
+    template void GameAdvance( BasicGameState<W, H>* gameState, uint32 numTicks ); \
+    template uint64 GameChecksum( const BasicGameState<W, H>* gameState );
+
+template struct BoardGeometry<PLAYAREA_WIDTH>;
+template struct BoardGeometry<WIDE_WIDTH>;
+template struct BoardGeometry<HUGE_WIDTH>;
+INSTANTIATE_ENGINE( PLAYAREA_WIDTH, PLAYAREA_HEIGHT )
+INSTANTIATE_ENGINE( WIDE_WIDTH, WIDE_HEIGHT )
+INSTANTIATE_ENGINE( HUGE_WIDTH, HUGE_HEIGHT )
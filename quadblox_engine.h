@@ -0,0 +1,294 @@
+#pragma once
+#include <stdint.h>
+#include <cstddef>
+#include <type_traits>
+
+// Rules engine. Nothing in here may depend on SDL, so it can run headless.
+
+typedef uint64_t uint64;
+typedef uint32_t uint32;
+typedef uint16_t uint16;
+typedef uint8_t uint8;
+typedef int8_t int8;
+
+// The engine is templated on board width and height, and instantiated in quadblox_engine.cpp for the classic
+// board plus the larger ones used for stress and research runs
+const int PLAYAREA_WIDTH = 10;
+const int PLAYAREA_HEIGHT = 20;
+const int WIDE_WIDTH = 16;
+const int WIDE_HEIGHT = 40;
+const int HUGE_WIDTH = 64;
+const int HUGE_HEIGHT = 128;
+
+// Each baked row is a bitmask in the narrowest unsigned type that holds W bits, column 0 in the highest of the W low bits
+template <int W>
+using BoardRow = typename std::conditional< W <= 8, uint8,
+                 typename std::conditional< W <= 16, uint16,
+                 typename std::conditional< W <= 32, uint32, uint64 >::type >::type >::type;
+
+template <int W>
+constexpr BoardRow<W> FullRow() {
+    static_assert( W >= 4 && W <= 64, "board must be 4 to 64 columns wide" );
+    BoardRow<W> ones = BoardRow<W>( ~BoardRow<W>( 0 ) );
+    return BoardRow<W>( ones >> ( 8 * sizeof( BoardRow<W> ) - W ) );
+}
+
+const uint16 FULL_ROW = FullRow<PLAYAREA_WIDTH>();
+
+const int NUM_BLOCKTYPES = 7;
+const int NUM_BLOCKSTATES = 4;
+const int TURBOFACTOR = 16;
+
+// Fixed simulation step. All game timers count whole ticks, so skipping idle ticks is exact.
+const double GAME_TICK_SECONDS = 0.01;
+const uint32 TICKS_PER_FALL = 100;
+const uint32 FLASH_TOGGLE_TICKS = 5;
+const uint32 FLASH_DURATION_TICKS = 50;
+// No event is coming on its own, e.g. while paused
+const uint32 NO_EVENT = 0xFFFFFFFF;
+
+extern const uint16_t BLOCKS[NUM_BLOCKTYPES][NUM_BLOCKSTATES];
+
+// Everything about the shape of one block type in one state, generated at compile time from BLOCKS
+typedef struct BlockGeometry {
+    uint8 cols;
+    // Empty columns and rows on each side of the 4x4 grid
+    int8 left;
+    int8 right;
+    int8 top;
+    int8 bottom;
+    uint8 rows[4];
+} BlockGeometry;
+
+typedef struct BlockGeometryTable {
+    BlockGeometry blocks[NUM_BLOCKTYPES][NUM_BLOCKSTATES];
+} BlockGeometryTable;
+
+extern const BlockGeometryTable BLOCK_GEOMETRY;
+
+// Lowest x offset that BlockOnBoard::boardRows covers, the highest is W + 3. Further out no cell is on the board.
+const int BOARD_MASK_MIN_X = -4;
+
+// Where one block state can go on a board W columns wide, generated at compile time
+template <int W>
+struct BlockOnBoard {
+    // Offsets that keep the block inside the play area
+    int8 minX;
+    int8 maxX;
+    // Each row shifted into board coordinates for every x offset, cells outside the play area dropped
+    BoardRow<W> boardRows[W + 3 - BOARD_MASK_MIN_X + 1][4];
+};
+
+template <int W>
+struct BoardGeometry {
+    BlockOnBoard<W> blocks[NUM_BLOCKTYPES][NUM_BLOCKSTATES];
+    // Defined in quadblox_engine.cpp for each instantiated width
+    static const BoardGeometry table;
+};
+
+struct QuadBlock {
+    int x;
+    int y;
+    int blockType;
+    int currentState;
+    uint16 state;
+};
+
+inline const BlockGeometry& Geometry( const QuadBlock& qb ) {
+    return BLOCK_GEOMETRY.blocks[qb.blockType][qb.currentState];
+}
+
+template <int W = PLAYAREA_WIDTH>
+inline const BlockOnBoard<W>& OnBoard( const QuadBlock& qb ) {
+    return BoardGeometry<W>::table.blocks[qb.blockType][qb.currentState];
+}
+
+typedef BoardRow<PLAYAREA_WIDTH> GameBlocks[PLAYAREA_HEIGHT];
+typedef int8 GameColors[PLAYAREA_HEIGHT][PLAYAREA_WIDTH];
+
+// Summary of a board, kept up to date as cells are baked and rows cleared so that nothing needs a rescan.
+// A height counts from the floor to a column's top cell, 0 for an empty column.
+template <int W, int H>
+struct BoardMetrics {
+    uint8 rowFill[H] = { 0 };
+    uint8 columnHeight[W] = { 0 };
+    int filledCells = 0;
+    int aggregateHeight = 0;
+    // Empty cells under a column's top cell
+    int holes = 0;
+    // Sum of height differences between neighbouring columns
+    int bumpiness = 0;
+    int maxHeight = 0;
+};
+
+typedef BoardMetrics<PLAYAREA_WIDTH, PLAYAREA_HEIGHT> GameMetrics;
+
+template <int W, int H>
+struct BasicGameState {
+    // Ticks stepped and the piece generator. Both carry over InitGame, so a whole session replays from one seed.
+    uint32 tick = 0;
+    uint64 rngState = 0x9E3779B97F4A7C15ull;
+
+    uint32 ticksSinceLastFall = 0;
+    uint32 ticksPerFall = TICKS_PER_FALL;
+    // The piece in play, held by value so the whole state copies with a memcpy. Meaningless unless hasCurrentBlock.
+    QuadBlock currentBlock = { 0, 0, 0, 0, 0 };
+    bool hasCurrentBlock = false;
+    // Piece that spawns after currentBlock lands, -1 until the first spawn
+    int nextBlockType = -1;
+    // Occupancy bitboard for collision, plus the block type of each cell for rendering (-1 is empty)
+    BoardRow<W> blockBake[H] = { 0 };
+    // Zobrist hash of blockBake, updated row by row as rows change rather than recomputed
+    uint64 boardHash = 0;
+    BoardMetrics<W, H> metrics;
+    int8 blockColor[H][W];
+    // Bumped whenever a row's contents change, so renderers can cache rows and redraw only what changed
+    uint32 rowVersion[H] = { 0 };
+    int horizMove = 0;
+    int rotate = 0;
+    int linesCleared = 0;
+
+    bool wantsToQuit = false;
+    bool paused = false;
+    bool turbo = false;
+    bool gameOver = false;
+
+    //Completed rows animation logic, in ticks
+    uint32 animating = 0;
+    int numCompleteRows = 0;
+    int completeRows[4] = { 0, 0, 0, 0 };
+    bool flashOn = false;
+    uint32 flashAccumulator = 0;
+};
+
+typedef BasicGameState<PLAYAREA_WIDTH, PLAYAREA_HEIGHT> GameState;
+
+// Everything a player can do between two ticks. Moves and rotations accumulate until consumed.
+typedef struct GameInput {
+    int horizMove = 0;
+    int rotate = 0;
+    bool turboOn = false;
+    bool turboOff = false;
+    bool togglePause = false;
+    bool quit = false;
+} GameInput;
+
+inline bool InputIsEmpty( const GameInput& input ) {
+    return input.horizMove == 0 && input.rotate == 0 && !input.turboOn && !input.turboOff && !input.togglePause && !input.quit;
+}
+
+void RotateBlock( QuadBlock& qb, int numTimes );
+
+inline int Left( const QuadBlock& qb ) { return Geometry( qb ).left; }
+inline int Right( const QuadBlock& qb ) { return Geometry( qb ).right; }
+inline int Top( const QuadBlock& qb ) { return Geometry( qb ).top; }
+inline int Bottom( const QuadBlock& qb ) { return Geometry( qb ).bottom; }
+inline int Row( const QuadBlock& qb, int i ) { return Geometry( qb ).rows[i]; }
+inline int Cell( const QuadBlock& qb, int r, int c ) { return 1 & ( Row( qb, r ) >> ( 4 - c - 1 ) ); }
+
+// Row i of the block placed at offset x, in board coordinates. Cells that fall outside the play area are dropped.
+template <int W = PLAYAREA_WIDTH>
+inline BoardRow<W> BoardRowMask( const QuadBlock& qb, int i, int x ) {
+    if ( x < BOARD_MASK_MIN_X || x > W + 3 ) {
+        return 0;
+    }
+
+    return OnBoard<W>( qb ).boardRows[x - BOARD_MASK_MIN_X][i];
+}
+
+// Zobrist key of one occupied cell. Mixed on the fly instead of looked up, so it serves every board size.
+constexpr uint64 ZobristCell( int row, int col ) {
+    uint64 z = ( uint64( row ) << 16 | uint64( col ) ) * 0x9E3779B97F4A7C15ull;
+    z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ull;
+    z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBull;
+    return z ^ ( z >> 31 );
+}
+
+// XOR of the keys of the occupied cells in one row of bits
+template <int W = PLAYAREA_WIDTH>
+inline uint64 ZobristRow( int row, BoardRow<W> bits ) {
+    uint64 hash = 0;
+    uint64 remaining = bits;
+    while ( remaining != 0 ) {
+        hash ^= ZobristCell( row, W - 1 - __builtin_ctzll( remaining ) );
+        remaining &= remaining - 1;
+    }
+    return hash;
+}
+
+// Zobrist hash of a whole board, from scratch
+template <int W = PLAYAREA_WIDTH, int H = PLAYAREA_HEIGHT>
+inline uint64 BoardHash( const BoardRow<W>* rows ) {
+    uint64 hash = 0;
+    for ( int row = 0; row < H; row++ ) {
+        hash ^= ZobristRow<W>( row, rows[row] );
+    }
+    return hash;
+}
+
+// Everything below works on any instantiated board size. The bake arguments are raw row arrays, so the size only
+// needs spelling out for boards other than the classic one.
+
+template <int W, int H>
+QuadBlock SpawnQuadBlock( BasicGameState<W, H>* gameState, int blockType );
+// What SpawnQuadBlock does, drawing from a bare generator state instead of a game's
+template <int W>
+QuadBlock RandomQuadBlock( uint64* rngState, int blockType );
+template <int W, int H>
+void bakeBlock( BasicGameState<W, H>* gameState, const QuadBlock* qb );
+template <int W = PLAYAREA_WIDTH, int H = PLAYAREA_HEIGHT>
+bool blockHitsBake( const QuadBlock& qb, const BoardRow<W>* blockBake, const int verticalLookahead, const int horizLookahead );
+// Full rows among the four qb covers, top to bottom. Baking qb cannot have filled any other row.
+template <int W, int H>
+void findCompleteRows( const BoardMetrics<W, H>& metrics, const QuadBlock& qb, int outRows[4], int& outNumRows );
+template <int W, int H>
+void ClearCompletedRows( BasicGameState<W, H>* gameState );
+// The bake side of ClearCompletedRows on a bare board: remove clearedRows, their indices in ascending order, move
+// everything above them down, and account for it in metrics
+template <int W, int H>
+void BoardClearRows( BoardRow<W>* rows, BoardMetrics<W, H>* metrics, const int* clearedRows, int numRows );
+template <int W, int H>
+void updateGame( BasicGameState<W, H>* gameState );
+
+// Account for cells newly filled in one row. None of them may have been filled already.
+template <int W, int H>
+void BoardMetricsAdd( BoardMetrics<W, H>* metrics, int row, BoardRow<W> cells );
+// Account for full rows being removed. rows is the board afterwards, with everything above them moved down;
+// clearedRows are the removed rows' old indices, in ascending order.
+template <int W, int H>
+void BoardMetricsClearRows( BoardMetrics<W, H>* metrics, const BoardRow<W>* rows, const int* clearedRows, int numRows );
+// From scratch, for boards that did not come from an empty one cell by cell
+template <int W, int H>
+void BoardMetricsFromRows( BoardMetrics<W, H>* metrics, const BoardRow<W>* rows );
+
+// Deterministic per-game generator, replaces rand() so a seed and an input log reproduce a run exactly
+template <int W, int H>
+void SeedGame( BasicGameState<W, H>* gameState, uint64 seed );
+template <int W, int H>
+uint32 GameRandom( BasicGameState<W, H>* gameState );
+// The same generator on a bare state, for simulators that keep boards of their own
+uint64 SeedRandom( uint64 seed );
+uint32 NextRandom( uint64* state );
+
+// Empty board, no piece in play
+template <int W, int H>
+void InitGame( BasicGameState<W, H>* gameState );
+template <int W, int H>
+void ApplyInput( BasicGameState<W, H>* gameState, const GameInput& input );
+// Apply input, then advance the game by one GAME_TICK_SECONDS step
+template <int W, int H>
+void GameStep( BasicGameState<W, H>* gameState, const GameInput& input );
+
+// How many of the coming ticks, stepped with no input, would do nothing but count down timers.
+// NO_EVENT if nothing will ever happen without input.
+template <int W, int H>
+uint32 GameTicksUntilEvent( const BasicGameState<W, H>* gameState );
+// Jump over numTicks idle ticks. numTicks must not exceed GameTicksUntilEvent; the result is identical to stepping them.
+template <int W, int H>
+void GameSkipTicks( BasicGameState<W, H>* gameState, uint32 numTicks );
+// Advance numTicks with no input, skipping idle stretches and stepping only ticks where something happens
+template <int W, int H>
+void GameAdvance( BasicGameState<W, H>* gameState, uint32 numTicks );
+// Hash of everything that affects play, for checking that two runs ended up in the same place
+template <int W, int H>
+uint64 GameChecksum( const BasicGameState<W, H>* gameState );
@@ -0,0 +1,83 @@
+#include <cstdio>
+#include "quadblox_input.h"
+
+static bool keyAction( const SDL_Event& e, InputAction::Enum* action ) {
+    if ( e.type == SDL_KEYUP ) {
+        if ( e.key.keysym.sym == SDLK_DOWN ) {
+            *action = InputAction::TURBO_OFF;
+            return true;
+        }
+        return false;
+    }
+    if ( e.type != SDL_KEYDOWN ) {
+        return false;
+    }
+    switch ( e.key.keysym.sym ) {
+        case SDLK_LEFT: *action = InputAction::LEFT; return true;
+        case SDLK_RIGHT: *action = InputAction::RIGHT; return true;
+        case SDLK_UP: *action = InputAction::ROTATE; return true;
+        case SDLK_DOWN: *action = InputAction::TURBO_ON; return true;
+        case SDLK_p: *action = InputAction::PAUSE; return true;
+        case SDLK_q:
+        case SDLK_ESCAPE: *action = InputAction::QUIT; return true;
+        default: return false;
+    }
+}
+
+static int SDLCALL inputWatch( void* userdata, SDL_Event* e ) {
+    InputQueue* queue = (InputQueue*)userdata;
+    InputAction::Enum action;
+    if ( keyAction( *e, &action ) ) {
+        TimedInput input = { SDL_GetPerformanceCounter(), uint8( action ) };
+        if ( !queue->ring.Push( input ) ) {
+            queue->dropped.fetch_add( 1, std::memory_order_relaxed );
+        }
+    }
+    return 1;
+}
+
+void InputQueueInstall( InputQueue* queue ) {
+    queue->perfFreq = SDL_GetPerformanceFrequency();
+    SDL_AddEventWatch( inputWatch, queue );
+}
+
+void InputQueueRemove( InputQueue* queue ) {
+    SDL_DelEventWatch( inputWatch, queue );
+}
+
+GameInput InputQueueTake( InputQueue* queue, Uint64 tickTime ) {
+    GameInput input;
+    uint32 taken = 0;
+    TimedInput next;
+    Uint64 now = 0;
+    while ( queue->ring.Peek( &next ) && next.timestamp <= tickTime && !( taken & ( 1u << next.action ) ) ) {
+        queue->ring.Pop();
+        taken |= 1u << next.action;
+        AddInputAction( &input, InputAction::Enum( next.action ) );
+        // The tick is stepped right after this, so now is when the press changes the game
+        if ( now == 0 ) {
+            now = SDL_GetPerformanceCounter();
+        }
+        LatencyRecord( &queue->latency, uint64( double( now - next.timestamp ) * 1e9 / double( queue->perfFreq ) ) );
+    }
+    return input;
+}
+
+uint32 InputQueueTicksUntilInput( const InputQueue* queue, Uint64 tickTime, Uint64 tickPeriod ) {
+    TimedInput next;
+    if ( !queue->ring.Peek( &next ) ) {
+        return NO_EVENT;
+    }
+    if ( next.timestamp <= tickTime ) {
+        return 0;
+    }
+    return uint32( ( next.timestamp - tickTime + tickPeriod - 1 ) / tickPeriod );
+}
+
+void InputQueuePrintStats( const InputQueue* queue ) {
+    const LatencyHistogram& latency = queue->latency;
+    printf( "Input latency: %llu presses, p50 %.2fms p99 %.2fms max %.2fms, %u dropped\n",
+            (unsigned long long)latency.total, double( LatencyPercentile( latency, 0.5 ) ) / 1e6,
+            double( LatencyPercentile( latency, 0.99 ) ) / 1e6, double( latency.max ) / 1e6,
+            queue->dropped.load() );
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <atomic>
+#include "SDL.h"
+#include "quadblox_engine.h"
+#include "quadblox_latency.h"
+#include "quadblox_replay.h"
+#include "quadblox_spsc.h"
+
+// Key presses stamped with the performance counter the moment SDL hands them over, and queued for the
+// simulation, which applies each one on the fixed-step tick its timestamp falls in.
+//
+// SDL only delivers events to the thread that pumps them, and only the video thread may pump. An event watch
+// sees each event as the pump receives it, so the producer is whichever thread pumps, and FramePacer pumps
+// through its idle wait to keep timestamps within a millisecond of the key.
+
+const uint32 INPUT_QUEUE_SIZE = 256;
+
+typedef struct TimedInput {
+    Uint64 timestamp;
+    uint8 action;
+} TimedInput;
+
+typedef struct InputQueue {
+    SpscRing<TimedInput, INPUT_QUEUE_SIZE> ring;
+    Uint64 perfFreq = 0;
+    // Presses lost to a full ring
+    std::atomic<uint32> dropped;
+    // Arrival to the tick that applied it, consumer side only
+    LatencyHistogram latency;
+
+    InputQueue() : dropped( 0 ) {}
+} InputQueue;
+
+// Start and stop feeding queue from SDL key events
+void InputQueueInstall( InputQueue* queue );
+void InputQueueRemove( InputQueue* queue );
+
+// Input for the tick at tickTime: every queued press stamped at or before it. An action is taken at most once
+// per tick, so a second press of the same key waits for the next tick instead of being merged or lost.
+GameInput InputQueueTake( InputQueue* queue, Uint64 tickTime );
+// Ticks after the one at tickTime until the next queued press is due, NO_EVENT when nothing is queued
+uint32 InputQueueTicksUntilInput( const InputQueue* queue, Uint64 tickTime, Uint64 tickPeriod );
+void InputQueuePrintStats( const InputQueue* queue );
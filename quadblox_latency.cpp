@@ -0,0 +1,50 @@
+#include "quadblox_latency.h"
+
+static int latencyBucket( uint64 ns ) {
+    if ( ns < 16 ) {
+        return int( ns );
+    }
+    int exponent = 63 - __builtin_clzll( ns );
+    int mantissa = int( ( ns >> ( exponent - 2 ) ) & 3 );
+    return 16 + ( exponent - 4 ) * 4 + mantissa;
+}
+
+static uint64 latencyBucketLimit( int bucket ) {
+    if ( bucket < 16 ) {
+        return uint64( bucket );
+    }
+    int exponent = ( bucket - 16 ) / 4 + 4;
+    uint64 mantissa = uint64( ( bucket - 16 ) % 4 );
+    return ( ( 5 + mantissa ) << ( exponent - 2 ) ) - 1;
+}
+
+void LatencyRecord( LatencyHistogram* histogram, uint64 ns ) {
+    histogram->counts[latencyBucket( ns )]++;
+    histogram->total++;
+    if ( ns > histogram->max ) {
+        histogram->max = ns;
+    }
+}
+
+void LatencyMerge( LatencyHistogram* into, const LatencyHistogram& from ) {
+    for ( int i = 0; i < LATENCY_BUCKETS; i++ ) {
+        into->counts[i] += from.counts[i];
+    }
+    into->total += from.total;
+    if ( from.max > into->max ) {
+        into->max = from.max;
+    }
+}
+
+uint64 LatencyPercentile( const LatencyHistogram& histogram, double fraction ) {
+    uint64 target = uint64( fraction * double( histogram.total ) );
+    uint64 seen = 0;
+    for ( int i = 0; i < LATENCY_BUCKETS; i++ ) {
+        seen += histogram.counts[i];
+        if ( seen > target ) {
+            uint64 limit = latencyBucketLimit( i );
+            return limit < histogram.max ? limit : histogram.max;
+        }
+    }
+    return histogram.max;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include "quadblox_engine.h"
+
+// Log-linear histogram of nanosecond durations, four buckets per power of two
+const int LATENCY_BUCKETS = 256;
+
+typedef struct LatencyHistogram {
+    uint64 counts[LATENCY_BUCKETS] = { 0 };
+    uint64 total = 0;
+    uint64 max = 0;
+} LatencyHistogram;
+
+void LatencyRecord( LatencyHistogram* histogram, uint64 ns );
+void LatencyMerge( LatencyHistogram* into, const LatencyHistogram& from );
+// Upper bound of the bucket holding the given fraction of samples, e.g. 0.99
+uint64 LatencyPercentile( const LatencyHistogram& histogram, double fraction );
@@ -0,0 +1,100 @@
+#include <cstdio>
+#include <cstring>
+#include "quadblox_pacing.h"
+
+// SDL_Delay can oversleep by a scheduler quantum, so stop sleeping this long before the deadline
+const double SPIN_SECONDS = 0.002;
+
+const char* PacingModeName( PacingMode::Enum mode ) {
+    static const char* names[PacingMode::COUNT] = { "vsync", "hybrid", "uncapped" };
+    return names[mode];
+}
+
+bool ParsePacingMode( const char* name, PacingMode::Enum* outMode ) {
+    for ( int i = 0; i < PacingMode::COUNT; i++ ) {
+        if ( strcmp( name, PacingModeName( PacingMode::Enum( i ) ) ) == 0 ) {
+            *outMode = PacingMode::Enum( i );
+            return true;
+        }
+    }
+    return false;
+}
+
+void PacerInit( FramePacer* pacer, PacingMode::Enum mode, double targetFps ) {
+    pacer->mode = mode;
+    pacer->perfFreq = SDL_GetPerformanceFrequency();
+    pacer->targetTicks = uint64( double(pacer->perfFreq) / targetFps );
+    pacer->spinTicks = uint64( double(pacer->perfFreq) * SPIN_SECONDS );
+    pacer->lastFrameStart = SDL_GetPerformanceCounter();
+    pacer->deadline = pacer->lastFrameStart + pacer->targetTicks;
+    pacer->frames = 0;
+    pacer->missedDeadlines = 0;
+    pacer->jitterSum = 0;
+    pacer->jitterMax = 0;
+}
+
+static void waitUntil( FramePacer* pacer, uint64 deadline ) {
+    uint64 now = SDL_GetPerformanceCounter();
+    while ( now + pacer->spinTicks < deadline ) {
+        uint64 sleepTicks = deadline - now - pacer->spinTicks;
+        Uint32 sleepMs = Uint32( sleepTicks * 1000 / pacer->perfFreq );
+        if ( sleepMs == 0 ) {
+            break;
+        }
+        if ( pacer->pumpEvents ) {
+            SDL_PumpEvents();
+            sleepMs = 1;
+        }
+        SDL_Delay( sleepMs );
+        now = SDL_GetPerformanceCounter();
+    }
+    while ( now < deadline ) {
+        if ( pacer->pumpEvents ) {
+            SDL_PumpEvents();
+        }
+        now = SDL_GetPerformanceCounter();
+    }
+}
+
+double PacerBeginFrame( FramePacer* pacer ) {
+    if ( pacer->mode == PacingMode::HYBRID ) {
+        if ( SDL_GetPerformanceCounter() > pacer->deadline ) {
+            pacer->missedDeadlines++;
+        } else {
+            waitUntil( pacer, pacer->deadline );
+        }
+    }
+
+    uint64 now = SDL_GetPerformanceCounter();
+    uint64 frameTicks = now - pacer->lastFrameStart;
+    pacer->lastFrameStart = now;
+
+    if ( pacer->mode == PacingMode::HYBRID ) {
+        pacer->deadline += pacer->targetTicks;
+        // Fell more than a frame behind: start a fresh schedule rather than rushing frames to catch up
+        if ( pacer->deadline < now ) {
+            pacer->deadline = now + pacer->targetTicks;
+        }
+    } else if ( pacer->mode == PacingMode::VSYNC && frameTicks > pacer->targetTicks + pacer->targetTicks / 2 ) {
+        // Present blocks until vblank, so a frame this long skipped at least one refresh
+        pacer->missedDeadlines++;
+    }
+
+    if ( pacer->mode != PacingMode::UNCAPPED && pacer->frames > 0 ) {
+        double jitter = ( double(frameTicks) - double(pacer->targetTicks) ) / double(pacer->perfFreq);
+        jitter = jitter < 0 ? -jitter : jitter;
+        pacer->jitterSum += jitter;
+        if ( jitter > pacer->jitterMax ) {
+            pacer->jitterMax = jitter;
+        }
+    }
+    pacer->frames++;
+    return double(frameTicks) / double(pacer->perfFreq);
+}
+
+void PacerPrintStats( const FramePacer* pacer ) {
+    long long measured = pacer->frames > 1 ? pacer->frames - 1 : 1;
+    printf( "Frame pacing (%s): %lld frames, %lld missed deadlines, jitter avg %.3fms max %.3fms\n",
+            PacingModeName( pacer->mode ), pacer->frames, pacer->missedDeadlines,
+            1000.0 * pacer->jitterSum / double(measured), 1000.0 * pacer->jitterMax );
+}
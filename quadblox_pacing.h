@@ -0,0 +1,41 @@
+#pragma once
+#include "SDL.h"
+#include "quadblox_engine.h"
+
+// Frame pacing. VSYNC lets SDL_RenderPresent block on the display. HYBRID sleeps until just before the deadline and
+// spins the rest, so the core is idle for most of the frame. UNCAPPED runs as fast as it can.
+
+namespace PacingMode {
+    enum Enum {
+        VSYNC,
+        HYBRID,
+        UNCAPPED,
+        COUNT
+    };
+}
+
+typedef struct FramePacer {
+    PacingMode::Enum mode = PacingMode::HYBRID;
+    uint64 perfFreq = 0;
+    uint64 targetTicks = 0;
+    // Stop sleeping this far ahead of the deadline, to absorb the scheduler's wakeup latency
+    uint64 spinTicks = 0;
+    uint64 deadline = 0;
+    uint64 lastFrameStart = 0;
+    // Pump SDL events through the wait, a millisecond at a time, so key presses reach event watches when they
+    // happen rather than at the start of the next frame
+    bool pumpEvents = false;
+
+    long long frames = 0;
+    long long missedDeadlines = 0;
+    double jitterSum = 0;
+    double jitterMax = 0;
+} FramePacer;
+
+const char* PacingModeName( PacingMode::Enum mode );
+bool ParsePacingMode( const char* name, PacingMode::Enum* outMode );
+
+void PacerInit( FramePacer* pacer, PacingMode::Enum mode, double targetFps );
+// Wait for the start of the next frame. Returns the seconds since the previous frame started.
+double PacerBeginFrame( FramePacer* pacer );
+void PacerPrintStats( const FramePacer* pacer );
@@ -0,0 +1,259 @@
+#include <cstdio>
+#include <cstring>
+#include "SDL_image.h"
+#include "quadblox_pack.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const char ASSET_PACK_MAGIC[4] = { 'Q', 'B', 'P', 'K' };
+
+SDL_Surface* PackBlockAtlas( SDL_Surface* const* blockSurfaces, SDL_Rect* outRects ) {
+    SDL_Surface* surfaces[NUM_BLOCKTYPES + 1];
+    for ( int i = 0; i < NUM_BLOCKTYPES; i++ ) {
+        surfaces[i] = blockSurfaces[i];
+    }
+    SDL_Surface* white = SDL_CreateRGBSurfaceWithFormat( 0, 4, 4, 32, SDL_PIXELFORMAT_RGBA32 );
+    if ( white == NULL ) {
+        return NULL;
+    }
+    SDL_FillRect( white, NULL, SDL_MapRGBA( white->format, 0xFF, 0xFF, 0xFF, 0xFF ) );
+    surfaces[NUM_BLOCKTYPES] = white;
+
+    SDL_Surface* atlas = PackAtlas( surfaces, NUM_BLOCKTYPES + 1, outRects );
+    SDL_FreeSurface( white );
+    return atlas;
+}
+
+static PackRect packRect( const SDL_Rect& rect ) {
+    PackRect packed = { rect.x, rect.y, rect.w, rect.h };
+    return packed;
+}
+
+static SDL_Rect unpackRect( const PackRect& rect ) {
+    return Rect( rect.x, rect.y, rect.w, rect.h );
+}
+
+static uint32 alignUp( uint32 offset ) {
+    return ( offset + ASSET_PACK_ALIGN - 1 ) / ASSET_PACK_ALIGN * ASSET_PACK_ALIGN;
+}
+
+bool WriteAssetPack( const char* assetDir, const char* outPath ) {
+    AssetPackHeader header;
+    memset( &header, 0, sizeof( header ) );
+    memcpy( header.magic, ASSET_PACK_MAGIC, sizeof( header.magic ) );
+    header.version = ASSET_PACK_VERSION;
+    header.format = ASSET_PACK_FORMAT;
+
+    SDL_Surface* loaded[AssetType::COUNT] = { NULL };
+    SDL_Surface* images[PackImage::COUNT] = { NULL };
+    bool success = true;
+    char path[512];
+    for ( size_t i = 0; i < AssetType::COUNT && success; i++ ) {
+        snprintf( path, sizeof( path ), "%s/%s", assetDir, AssetTextureFiles[i] );
+        loaded[i] = IMG_Load( path );
+        if ( loaded[i] == NULL ) {
+            printf( "Failed to load %s: %s\n", path, IMG_GetError() );
+            success = false;
+        }
+    }
+
+    SDL_Rect blockRects[NUM_BLOCKTYPES + 1];
+    if ( success ) {
+        images[PackImage::BLOCK_ATLAS] = PackBlockAtlas( loaded, blockRects );
+        images[PackImage::BACKGROUND] = loaded[AssetType::BACKGROUND];
+        loaded[AssetType::BACKGROUND] = NULL;
+        for ( int i = 0; i < NUM_BLOCKTYPES; i++ ) {
+            header.blockRects[i] = packRect( blockRects[i] );
+        }
+        header.whiteRect = packRect( blockRects[NUM_BLOCKTYPES] );
+    }
+
+    TTF_Font* font = NULL;
+    if ( success ) {
+        snprintf( path, sizeof( path ), "%s/%s", assetDir, FONT_FILE );
+        font = TTF_OpenFont( path, FONT_SIZE );
+        if ( font == NULL ) {
+            printf( "Failed to open font %s: %s\n", path, TTF_GetError() );
+            success = false;
+        }
+    }
+    if ( success ) {
+        GlyphAtlas glyphs;
+        images[PackImage::GLYPHS] = RasterizeGlyphs( font, &glyphs );
+        for ( int i = 0; i < GLYPH_COUNT; i++ ) {
+            header.glyphRects[i] = packRect( glyphs.rects[i] );
+            header.glyphAdvance[i] = glyphs.advance[i];
+        }
+        header.lineSkip = glyphs.lineSkip;
+        TTF_CloseFont( font );
+    }
+
+    // Convert everything to the pack format, and lay the images out after the header
+    uint32 offset = alignUp( uint32( sizeof( header ) ) );
+    for ( int i = 0; i < PackImage::COUNT && success; i++ ) {
+        SDL_Surface* converted = images[i] ? SDL_ConvertSurfaceFormat( images[i], ASSET_PACK_FORMAT, 0 ) : NULL;
+        SDL_FreeSurface( images[i] );
+        images[i] = converted;
+        if ( converted == NULL ) {
+            printf( "Failed to convert pack image %d: %s\n", i, SDL_GetError() );
+            success = false;
+            break;
+        }
+        PackImageInfo& info = header.images[i];
+        info.offset = offset;
+        info.width = uint32( converted->w );
+        info.height = uint32( converted->h );
+        info.pitch = uint32( converted->w ) * 4;
+        offset = alignUp( offset + info.pitch * info.height );
+    }
+
+    FILE* file = success ? fopen( outPath, "wb" ) : NULL;
+    if ( success && file == NULL ) {
+        printf( "Failed to open %s for writing\n", outPath );
+        success = false;
+    }
+    if ( success ) {
+        static const char zeros[ASSET_PACK_ALIGN] = { 0 };
+        uint32 written = uint32( fwrite( &header, 1, sizeof( header ), file ) );
+        for ( int i = 0; i < PackImage::COUNT; i++ ) {
+            const PackImageInfo& info = header.images[i];
+            written += uint32( fwrite( zeros, 1, info.offset - written, file ) );
+            const uint8* pixels = (const uint8*)images[i]->pixels;
+            for ( uint32 row = 0; row < info.height; row++ ) {
+                written += uint32( fwrite( pixels + size_t( row ) * size_t( images[i]->pitch ), 1, info.pitch, file ) );
+            }
+        }
+        success = fclose( file ) == 0 && written == header.images[PackImage::COUNT - 1].offset +
+                  header.images[PackImage::COUNT - 1].pitch * header.images[PackImage::COUNT - 1].height;
+        if ( success ) {
+            printf( "Wrote %s: %u bytes\n", outPath, written );
+        } else {
+            printf( "Failed to write %s\n", outPath );
+        }
+    }
+
+    for ( int i = 0; i < NUM_BLOCKTYPES; i++ ) {
+        SDL_FreeSurface( loaded[i] );
+    }
+    SDL_FreeSurface( loaded[AssetType::BACKGROUND] );
+    for ( int i = 0; i < PackImage::COUNT; i++ ) {
+        SDL_FreeSurface( images[i] );
+    }
+    return success;
+}
+
+// Read-only view of the pack file for the duration of the upload
+typedef struct PackMapping {
+    const uint8* data = NULL;
+    size_t size = 0;
+} PackMapping;
+
+static bool mapPack( const char* path, PackMapping* mapping ) {
+#ifndef _WIN32
+    int fd = open( path, O_RDONLY );
+    if ( fd < 0 ) {
+        return false;
+    }
+    struct stat info;
+    void* data = MAP_FAILED;
+    if ( fstat( fd, &info ) == 0 && info.st_size > 0 ) {
+        data = mmap( NULL, size_t( info.st_size ), PROT_READ, MAP_PRIVATE, fd, 0 );
+    }
+    close( fd );
+    if ( data == MAP_FAILED ) {
+        return false;
+    }
+    mapping->data = (const uint8*)data;
+    mapping->size = size_t( info.st_size );
+    return true;
+#else
+    mapping->data = (const uint8*)SDL_LoadFile( path, &mapping->size );
+    return mapping->data != NULL;
+#endif
+}
+
+static void unmapPack( PackMapping* mapping ) {
+#ifndef _WIN32
+    munmap( (void*)mapping->data, mapping->size );
+#else
+    SDL_free( (void*)mapping->data );
+#endif
+    mapping->data = NULL;
+}
+
+bool LoadAssetPack( SDL_Renderer* renderer, const char* path, Assets* assets ) {
+    Uint64 start = SDL_GetPerformanceCounter();
+    PackMapping mapping;
+    if ( !mapPack( path, &mapping ) ) {
+        return false;
+    }
+
+    AssetPackHeader header;
+    bool valid = mapping.size >= sizeof( header );
+    if ( valid ) {
+        memcpy( &header, mapping.data, sizeof( header ) );
+        valid = memcmp( header.magic, ASSET_PACK_MAGIC, sizeof( header.magic ) ) == 0 &&
+                header.version == ASSET_PACK_VERSION && header.format == ASSET_PACK_FORMAT;
+    }
+    for ( int i = 0; i < PackImage::COUNT && valid; i++ ) {
+        const PackImageInfo& info = header.images[i];
+        valid = info.pitch >= info.width * 4 && size_t( info.offset ) + size_t( info.pitch ) * info.height <= mapping.size;
+    }
+    if ( !valid ) {
+        printf( "Ignoring asset pack %s: wrong version or truncated\n", path );
+        unmapPack( &mapping );
+        return false;
+    }
+
+    SDL_Texture* textures[PackImage::COUNT] = { NULL };
+    bool success = true;
+    for ( int i = 0; i < PackImage::COUNT && success; i++ ) {
+        const PackImageInfo& info = header.images[i];
+        textures[i] = SDL_CreateTexture( renderer, header.format, SDL_TEXTUREACCESS_STATIC, int( info.width ), int( info.height ) );
+        success = textures[i] != NULL && SDL_UpdateTexture( textures[i], NULL, mapping.data + info.offset, int( info.pitch ) ) == 0;
+        if ( success ) {
+            SDL_SetTextureBlendMode( textures[i], SDL_BLENDMODE_BLEND );
+        } else {
+            printf( "Failed to upload asset pack image %d: %s\n", i, SDL_GetError() );
+        }
+    }
+    unmapPack( &mapping );
+    if ( !success ) {
+        for ( int i = 0; i < PackImage::COUNT; i++ ) {
+            if ( textures[i] ) {
+                SDL_DestroyTexture( textures[i] );
+            }
+        }
+        return false;
+    }
+
+    assets->blockAtlas = textures[PackImage::BLOCK_ATLAS];
+    assets->blockAtlasWidth = int( header.images[PackImage::BLOCK_ATLAS].width );
+    assets->blockAtlasHeight = int( header.images[PackImage::BLOCK_ATLAS].height );
+    for ( int i = 0; i < NUM_BLOCKTYPES; i++ ) {
+        assets->blockRects[i] = unpackRect( header.blockRects[i] );
+    }
+    assets->whiteRect = unpackRect( header.whiteRect );
+    SpriteBatchInit( &assets->sprites );
+
+    assets->textures[AssetType::BACKGROUND] = textures[PackImage::BACKGROUND];
+
+    GlyphAtlas& glyphs = assets->glyphs;
+    glyphs.texture = textures[PackImage::GLYPHS];
+    glyphs.width = int( header.images[PackImage::GLYPHS].width );
+    glyphs.height = int( header.images[PackImage::GLYPHS].height );
+    for ( int i = 0; i < GLYPH_COUNT; i++ ) {
+        glyphs.rects[i] = unpackRect( header.glyphRects[i] );
+        glyphs.advance[i] = header.glyphAdvance[i];
+    }
+    glyphs.lineSkip = header.lineSkip;
+
+    printf( "Asset pack %s mapped and uploaded in %.2fms\n", path,
+            1000.0 * double( SDL_GetPerformanceCounter() - start ) / double( SDL_GetPerformanceFrequency() ) );
+    return true;
+}
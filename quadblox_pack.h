@@ -0,0 +1,59 @@
+#pragma once
+#include "SDL.h"
+#include "quadblox.h"
+
+// Asset pack: every texture decoded, atlased and the glyphs rendered at build time by quadblox_pack, stored as
+// raw pixels in the format renderers most often use natively. At startup the file is mapped and each image is
+// uploaded straight from the mapping: no PNG decode, no font rasterizing, one file lookup.
+// Fields are native endian; the pack is a build artifact for the machine that runs it.
+
+const char ASSET_PACK_FILE[] = "assets.qbpak";
+const uint32 ASSET_PACK_VERSION = 1;
+const uint32 ASSET_PACK_FORMAT = SDL_PIXELFORMAT_ARGB8888;
+// Each image's pixels start on this boundary
+const uint32 ASSET_PACK_ALIGN = 64;
+
+namespace PackImage {
+    enum Enum {
+        BLOCK_ATLAS,
+        BACKGROUND,
+        GLYPHS,
+        COUNT
+    };
+}
+
+typedef struct PackImageInfo {
+    uint32 offset;
+    uint32 width;
+    uint32 height;
+    uint32 pitch;
+} PackImageInfo;
+
+typedef struct PackRect {
+    int32_t x;
+    int32_t y;
+    int32_t w;
+    int32_t h;
+} PackRect;
+
+typedef struct AssetPackHeader {
+    char magic[4];
+    uint32 version;
+    uint32 format;
+    PackImageInfo images[PackImage::COUNT];
+    PackRect blockRects[NUM_BLOCKTYPES];
+    PackRect whiteRect;
+    PackRect glyphRects[GLYPH_COUNT];
+    int32_t glyphAdvance[GLYPH_COUNT];
+    int32_t lineSkip;
+} AssetPackHeader;
+
+// The block images plus a white patch for highlights, packed into one surface. outRects gets NUM_BLOCKTYPES + 1
+// entries, the white patch last. Shared by the packer and the loose-file loader.
+SDL_Surface* PackBlockAtlas( SDL_Surface* const* blockSurfaces, SDL_Rect* outRects );
+
+// Build time: decode everything under assetDir and write the pack
+bool WriteAssetPack( const char* assetDir, const char* outPath );
+// Run time: map the pack and upload it into assets. Returns false, leaving assets untouched, if the pack is missing
+// or does not match this build.
+bool LoadAssetPack( SDL_Renderer* renderer, const char* path, Assets* assets );
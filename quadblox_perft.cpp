@@ -0,0 +1,120 @@
+#include <chrono>
+#include <cstring>
+#include <vector>
+#include "quadblox_perft.h"
+#include "quadblox_bot.h"
+#include "quadblox_threadpool.h"
+
+static const char PERFT_PIECE_LETTERS[NUM_BLOCKTYPES + 1] = "JLSZOTI";
+
+// Subtrees from this depth on become pool tasks, so the first pieces' placements are generated once, up front
+static const int PERFT_SPLIT_LEVEL = 2;
+
+// One subtree for the pool, with its own counts so no task shares a counter with another
+typedef struct PerftTask {
+    GameBlocks board;
+    uint64 hash;
+    GameMetrics metrics;
+    // The whole sequence and depth, of which this subtree covers everything from PERFT_SPLIT_LEVEL on
+    const int* pieces;
+    int depth;
+    PerftResult counts;
+} PerftTask;
+
+int ParsePerftPieces( const char* text, int* outPieces, int maxPieces ) {
+    int count = 0;
+    for ( ; *text != '\0' && count < maxPieces; text++ ) {
+        if ( *text == '?' ) {
+            outPieces[count++] = PERFT_ANY_PIECE;
+            continue;
+        }
+        const char* letter = strchr( PERFT_PIECE_LETTERS, *text );
+        if ( letter == NULL || *letter == '\0' ) {
+            return -1;
+        }
+        outPieces[count++] = int( letter - PERFT_PIECE_LETTERS );
+    }
+    return count;
+}
+
+static void countPlacements( const GameBlocks board, uint64 hash, const GameMetrics& metrics, const int* pieces, int depth,
+                             int level, PerftResult* result, std::vector<PerftTask>* split ) {
+    int firstType = pieces[0] == PERFT_ANY_PIECE ? 0 : pieces[0];
+    int lastType = pieces[0] == PERFT_ANY_PIECE ? NUM_BLOCKTYPES - 1 : pieces[0];
+    for ( int blockType = firstType; blockType <= lastType; blockType++ ) {
+        QuadBlock qb = BotSpawnPosition( blockType );
+        if ( blockHitsBake( qb, board, 0, 0 ) ) {
+            result->toppedOut[level]++;
+            continue;
+        }
+
+        BotPlacement placements[BOT_MAX_PLACEMENTS];
+        int numPlacements = BotListPlacements( board, hash, metrics, qb, placements );
+        result->placements[level] += numPlacements;
+        for ( int i = 0; i < numPlacements; i++ ) {
+            result->lines[level] += placements[i].linesCleared;
+            if ( depth == 1 ) {
+                continue;
+            }
+            if ( split != NULL && level + 1 == PERFT_SPLIT_LEVEL ) {
+                PerftTask task;
+                memcpy( task.board, placements[i].result, sizeof( GameBlocks ) );
+                task.hash = placements[i].hash;
+                task.metrics = placements[i].metrics;
+                split->push_back( task );
+            } else {
+                countPlacements( placements[i].result, placements[i].hash, placements[i].metrics, pieces + 1, depth - 1,
+                                 level + 1, result, split );
+            }
+        }
+    }
+}
+
+static void runPerftTask( void* arg ) {
+    PerftTask* task = (PerftTask*)arg;
+    countPlacements( task->board, task->hash, task->metrics, task->pieces + PERFT_SPLIT_LEVEL,
+                     task->depth - PERFT_SPLIT_LEVEL, PERFT_SPLIT_LEVEL, &task->counts, NULL );
+}
+
+static void mergeCounts( PerftResult* into, const PerftResult& from ) {
+    for ( int i = 0; i < PERFT_MAX_DEPTH; i++ ) {
+        into->placements[i] += from.placements[i];
+        into->toppedOut[i] += from.toppedOut[i];
+        into->lines[i] += from.lines[i];
+    }
+}
+
+PerftResult Perft( const GameBlocks board, const int* pieces, int depth, ThreadPool* pool ) {
+    PerftResult result;
+    depth = depth > PERFT_MAX_DEPTH ? PERFT_MAX_DEPTH : depth;
+    if ( depth <= 0 ) {
+        return result;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<PerftTask> tasks;
+    GameMetrics metrics;
+    BoardMetricsFromRows( &metrics, board );
+    countPlacements( board, BoardHash( board ), metrics, pieces, depth, 0, &result, pool ? &tasks : NULL );
+    for ( size_t i = 0; i < tasks.size(); i++ ) {
+        tasks[i].pieces = pieces;
+        tasks[i].depth = depth;
+        pool->Submit( runPerftTask, &tasks[i] );
+    }
+    if ( pool ) {
+        pool->Wait();
+    }
+    for ( size_t i = 0; i < tasks.size(); i++ ) {
+        mergeCounts( &result, tasks[i].counts );
+    }
+    result.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    return result;
+}
+
+long long PerftNodes( const PerftResult& result ) {
+    long long nodes = 0;
+    for ( int i = 0; i < PERFT_MAX_DEPTH; i++ ) {
+        nodes += result.placements[i];
+    }
+    return nodes;
+}
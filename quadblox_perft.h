@@ -0,0 +1,31 @@
+#pragma once
+#include "quadblox_engine.h"
+
+class ThreadPool;
+
+// Move generator benchmark and oracle, after chess perft: from a board and a piece sequence, count every sequence
+// of placements BotListPlacements generates, depth pieces deep. The counts only change if the rules or the move
+// generator do, so they can be compared across rewrites. Lines are cleared by BoardClearRows, the same code the
+// game's ClearCompletedRows runs.
+
+const int PERFT_MAX_DEPTH = 8;
+// Stands for each of the seven piece types in turn
+const int PERFT_ANY_PIECE = -1;
+
+typedef struct PerftResult {
+    // Placement sequences ending at each depth
+    long long placements[PERFT_MAX_DEPTH] = { 0 };
+    // Sequences cut short at each depth because the piece could not spawn
+    long long toppedOut[PERFT_MAX_DEPTH] = { 0 };
+    // Lines cleared by the placements at each depth, summed over every sequence
+    long long lines[PERFT_MAX_DEPTH] = { 0 };
+    double seconds = 0;
+} PerftResult;
+
+// Piece letters as in JLSZOTI, or ? for any piece. Returns how many were parsed, or -1 on a bad letter.
+int ParsePerftPieces( const char* text, int* outPieces, int maxPieces );
+
+// Count to depth pieces[0 .. depth-1] from board. Subtrees under the first two pieces are split across the pool;
+// with no pool the count runs on the calling thread.
+PerftResult Perft( const GameBlocks board, const int* pieces, int depth, ThreadPool* pool );
+long long PerftNodes( const PerftResult& result );
@@ -0,0 +1,138 @@
+#include <chrono>
+#include <cstdio>
+#include "quadblox_profile.h"
+
+const char* ProfileStageNames[ProfileStage::COUNT] = {
+    "frame",
+    "input",
+    "update",
+    "draw",
+    "text",
+    "present"
+};
+
+// Where the calling thread's samples go, NULL until it registers
+static thread_local ProfileThread* currentThread = NULL;
+static thread_local uint8 currentIndex = 0;
+
+uint64 ProfileNow() {
+    return uint64( std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch() ).count() );
+}
+
+void ProfilerInit( Profiler* profiler ) {
+    profiler->epoch = ProfileNow();
+    profiler->windowStart = profiler->epoch;
+    profiler->history.resize( PROFILE_HISTORY_SAMPLES );
+    profiler->historyNext = 0;
+    profiler->historyTotal = 0;
+}
+
+void ProfileThreadBegin( Profiler* profiler, const char* name ) {
+    int index = profiler->numThreads.fetch_add( 1 );
+    if ( index >= PROFILE_MAX_THREADS ) {
+        printf( "Profiler: no ring left for thread %s\n", name );
+        return;
+    }
+    profiler->threads[index].name = name;
+    currentThread = &profiler->threads[index];
+    currentIndex = uint8( index );
+}
+
+void ProfileRecord( ProfileStage::Enum stage, uint64 start, uint64 end ) {
+    if ( currentThread == NULL ) {
+        return;
+    }
+    ProfileSample sample = { start, end, uint8( stage ), currentIndex };
+    if ( !currentThread->ring.Push( sample ) ) {
+        currentThread->dropped.fetch_add( 1, std::memory_order_relaxed );
+    }
+}
+
+static int registeredThreads( const Profiler* profiler ) {
+    int count = profiler->numThreads.load();
+    return count < PROFILE_MAX_THREADS ? count : PROFILE_MAX_THREADS;
+}
+
+void ProfileDrain( Profiler* profiler, uint64 now ) {
+    int numThreads = registeredThreads( profiler );
+    for ( int i = 0; i < numThreads; i++ ) {
+        ProfileSample sample;
+        while ( profiler->threads[i].ring.Peek( &sample ) ) {
+            profiler->threads[i].ring.Pop();
+            uint64 ns = sample.end - sample.start;
+            LatencyRecord( &profiler->window[sample.stage], ns );
+            LatencyRecord( &profiler->total[sample.stage], ns );
+            profiler->history[profiler->historyNext] = sample;
+            profiler->historyNext = ( profiler->historyNext + 1 ) % PROFILE_HISTORY_SAMPLES;
+            profiler->historyTotal++;
+        }
+    }
+
+    if ( now - profiler->windowStart >= PROFILE_WINDOW_NS ) {
+        for ( int stage = 0; stage < ProfileStage::COUNT; stage++ ) {
+            profiler->shown[stage] = profiler->window[stage];
+            profiler->window[stage] = LatencyHistogram();
+        }
+        profiler->windowStart = now;
+    }
+}
+
+static double nsToMs( uint64 ns ) {
+    return double( ns ) / 1e6;
+}
+
+void ProfileFormatStage( const Profiler* profiler, ProfileStage::Enum stage, char* out, size_t size ) {
+    const LatencyHistogram& histogram = profiler->shown[stage];
+    snprintf( out, size, "%-8s p50 %5.2f  p99 %5.2f ms", ProfileStageNames[stage],
+              nsToMs( LatencyPercentile( histogram, 0.5 ) ), nsToMs( LatencyPercentile( histogram, 0.99 ) ) );
+}
+
+bool ProfileWriteTrace( const Profiler* profiler, const char* path ) {
+    FILE* file = fopen( path, "w" );
+    if ( file == NULL ) {
+        return false;
+    }
+    fprintf( file, "{\"traceEvents\":[" );
+    // Each event is preceded by its separator, so the list stays valid JSON however many there are
+    const char* separator = "\n";
+    int numThreads = registeredThreads( profiler );
+    for ( int i = 0; i < numThreads; i++ ) {
+        fprintf( file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", separator,
+                 i, profiler->threads[i].name ? profiler->threads[i].name : "unnamed" );
+        separator = ",\n";
+    }
+
+    // Oldest first, once the history has wrapped
+    size_t count = profiler->historyTotal < PROFILE_HISTORY_SAMPLES ? size_t( profiler->historyTotal ) : PROFILE_HISTORY_SAMPLES;
+    size_t first = profiler->historyTotal < PROFILE_HISTORY_SAMPLES ? 0 : profiler->historyNext;
+    for ( size_t i = 0; i < count; i++ ) {
+        const ProfileSample& sample = profiler->history[( first + i ) % PROFILE_HISTORY_SAMPLES];
+        fprintf( file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", separator,
+                 ProfileStageNames[sample.stage], sample.thread, double( sample.start - profiler->epoch ) / 1000.0,
+                 double( sample.end - sample.start ) / 1000.0 );
+        separator = ",\n";
+    }
+    fprintf( file, "\n],\"displayTimeUnit\":\"ms\"}\n" );
+    return fclose( file ) == 0;
+}
+
+void ProfilePrintStats( const Profiler* profiler ) {
+    printf( "Profile:\n" );
+    for ( int stage = 0; stage < ProfileStage::COUNT; stage++ ) {
+        const LatencyHistogram& histogram = profiler->total[stage];
+        if ( histogram.total == 0 ) {
+            continue;
+        }
+        printf( "    %-8s %8llu samples  p50 %7.3fms  p99 %7.3fms  max %7.3fms\n", ProfileStageNames[stage],
+                (unsigned long long)histogram.total, nsToMs( LatencyPercentile( histogram, 0.5 ) ),
+                nsToMs( LatencyPercentile( histogram, 0.99 ) ), nsToMs( histogram.max ) );
+    }
+    int numThreads = registeredThreads( profiler );
+    for ( int i = 0; i < numThreads; i++ ) {
+        uint64 dropped = profiler->threads[i].dropped.load();
+        if ( dropped > 0 ) {
+            printf( "    %llu samples dropped on thread %s\n", (unsigned long long)dropped, profiler->threads[i].name );
+        }
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include "quadblox_engine.h"
+#include "quadblox_latency.h"
+#include "quadblox_spsc.h"
+
+// Scoped stage timers. Each registered thread pushes its samples into its own ring, and one thread, the render
+// thread in the game, drains every ring once a frame. Drained samples feed a rolling window of percentiles for the
+// overlay, totals for the end of the run, and a history that can be written out as a Chrome trace.
+
+namespace ProfileStage {
+    enum Enum {
+        FRAME,
+        INPUT,
+        UPDATE,
+        DRAW,
+        TEXT,
+        PRESENT,
+        COUNT
+    };
+}
+
+extern const char* ProfileStageNames[ProfileStage::COUNT];
+
+const int PROFILE_MAX_THREADS = 4;
+const uint32 PROFILE_RING_SAMPLES = 1024;
+// Drained samples kept for the trace, the oldest overwritten first
+const size_t PROFILE_HISTORY_SAMPLES = 1 << 18;
+// Overlay percentiles cover this long a window, then start over
+const uint64 PROFILE_WINDOW_NS = 1000000000ull;
+
+// Nanoseconds on a steady clock
+typedef struct ProfileSample {
+    uint64 start;
+    uint64 end;
+    uint8 stage;
+    uint8 thread;
+} ProfileSample;
+
+typedef struct ProfileThread {
+    SpscRing<ProfileSample, PROFILE_RING_SAMPLES> ring;
+    const char* name = NULL;
+    // Samples lost to a full ring
+    std::atomic<uint64> dropped;
+
+    ProfileThread() : dropped( 0 ) {}
+} ProfileThread;
+
+typedef struct Profiler {
+    ProfileThread threads[PROFILE_MAX_THREADS];
+    std::atomic<int> numThreads;
+    // Trace timestamps count from here
+    uint64 epoch = 0;
+
+    std::vector<ProfileSample> history;
+    size_t historyNext = 0;
+    uint64 historyTotal = 0;
+
+    // Durations in the window being filled, the last full window as the overlay shows it, and the whole run
+    uint64 windowStart = 0;
+    LatencyHistogram window[ProfileStage::COUNT];
+    LatencyHistogram shown[ProfileStage::COUNT];
+    LatencyHistogram total[ProfileStage::COUNT];
+
+    Profiler() : numThreads( 0 ) {}
+} Profiler;
+
+uint64 ProfileNow();
+
+void ProfilerInit( Profiler* profiler );
+// Point the calling thread's samples at a ring of its own in profiler. Threads never registered record nothing.
+void ProfileThreadBegin( Profiler* profiler, const char* name );
+// One sample of stage on the calling thread
+void ProfileRecord( ProfileStage::Enum stage, uint64 start, uint64 end );
+// Consumer side: empty every thread's ring, as of now
+void ProfileDrain( Profiler* profiler, uint64 now );
+
+// One overlay line for stage from the last full window, e.g. "draw     p50  0.41  p99  1.20 ms"
+void ProfileFormatStage( const Profiler* profiler, ProfileStage::Enum stage, char* out, size_t size );
+// The history as Chrome trace event JSON, for chrome://tracing or Perfetto
+bool ProfileWriteTrace( const Profiler* profiler, const char* path );
+void ProfilePrintStats( const Profiler* profiler );
+
+// Times its own lifetime as one sample of stage
+class ProfileScope {
+public:
+    explicit ProfileScope( ProfileStage::Enum stage ) : stage( stage ), start( ProfileNow() ) {}
+    ~ProfileScope() { ProfileRecord( stage, start, ProfileNow() ); }
+
+private:
+    ProfileStage::Enum stage;
+    uint64 start;
+};
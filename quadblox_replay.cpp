@@ -0,0 +1,255 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "quadblox_replay.h"
+
+static const char INPUT_LOG_MAGIC[4] = { 'Q', 'B', 'I', 'L' };
+static const uint32 INPUT_LOG_VERSION = 1;
+
+void AddInputAction( GameInput* input, InputAction::Enum action ) {
+    switch ( action ) {
+        case InputAction::LEFT: input->horizMove -= 1; break;
+        case InputAction::RIGHT: input->horizMove += 1; break;
+        case InputAction::ROTATE: input->rotate += 1; break;
+        case InputAction::TURBO_ON: input->turboOn = true; break;
+        case InputAction::TURBO_OFF: input->turboOff = true; break;
+        case InputAction::PAUSE: input->togglePause = true; break;
+        case InputAction::QUIT: input->quit = true; break;
+        default: break;
+    }
+}
+
+static void recordAction( InputLog* log, uint32 tick, InputAction::Enum action, int count ) {
+    InputEvent event;
+    event.tick = tick;
+    event.action = action;
+    for ( int i = 0; i < count; i++ ) {
+        log->events.push_back( event );
+    }
+}
+
+void RecordInput( InputLog* log, uint32 tick, const GameInput& input ) {
+    recordAction( log, tick, InputAction::LEFT, input.horizMove < 0 ? -input.horizMove : 0 );
+    recordAction( log, tick, InputAction::RIGHT, input.horizMove > 0 ? input.horizMove : 0 );
+    recordAction( log, tick, InputAction::ROTATE, input.rotate );
+    recordAction( log, tick, InputAction::TURBO_ON, input.turboOn ? 1 : 0 );
+    recordAction( log, tick, InputAction::TURBO_OFF, input.turboOff ? 1 : 0 );
+    recordAction( log, tick, InputAction::PAUSE, input.togglePause ? 1 : 0 );
+    recordAction( log, tick, InputAction::QUIT, input.quit ? 1 : 0 );
+}
+
+GameInput LogInputForTick( const InputLog& log, size_t& cursor, uint32 tick ) {
+    GameInput input;
+    while ( cursor < log.events.size() && log.events[cursor].tick <= tick ) {
+        const InputEvent& event = log.events[cursor++];
+        if ( event.tick < tick ) {
+            continue;
+        }
+        AddInputAction( &input, InputAction::Enum( event.action ) );
+    }
+    return input;
+}
+
+static void writeFixed( uint8*& out, uint64 value, int bytes ) {
+    for ( int i = 0; i < bytes; i++ ) {
+        *out++ = uint8( value >> ( 8 * i ) );
+    }
+}
+
+static bool writeHeader( FILE* file, uint64 seed, uint32 endTick, uint32 count ) {
+    uint8 header[24];
+    memcpy( header, INPUT_LOG_MAGIC, 4 );
+    uint8* out = header + 4;
+    writeFixed( out, INPUT_LOG_VERSION, 4 );
+    writeFixed( out, seed, 8 );
+    writeFixed( out, endTick, 4 );
+    writeFixed( out, count, 4 );
+    return fwrite( header, 1, sizeof( header ), file ) == sizeof( header );
+}
+
+// Encodes through a buffer on the stack, so writing a chunk mid-game never allocates
+static bool writeEvents( FILE* file, const InputEvent* events, size_t count, uint32& lastTick ) {
+    uint8 buffer[4096];
+    size_t used = 0;
+    for ( size_t i = 0; i < count; i++ ) {
+        // Room for a full 5-byte varint and the action
+        if ( used + 6 > sizeof( buffer ) ) {
+            if ( fwrite( buffer, 1, used, file ) != used ) {
+                return false;
+            }
+            used = 0;
+        }
+        uint32 delta = events[i].tick - lastTick;
+        lastTick = events[i].tick;
+        do {
+            uint8 byte = uint8( delta & 0x7F );
+            delta >>= 7;
+            buffer[used++] = delta ? uint8( byte | 0x80 ) : byte;
+        } while ( delta );
+        buffer[used++] = events[i].action;
+    }
+    return fwrite( buffer, 1, used, file ) == used;
+}
+
+static bool readFixed( const std::vector<uint8>& in, size_t& pos, uint64& value, int bytes ) {
+    if ( pos + size_t(bytes) > in.size() ) {
+        return false;
+    }
+    value = 0;
+    for ( int i = 0; i < bytes; i++ ) {
+        value |= uint64( in[pos++] ) << ( 8 * i );
+    }
+    return true;
+}
+
+bool SaveInputLog( const char* path, const InputLog& log ) {
+    FILE* file = fopen( path, "wb" );
+    if ( file == NULL ) {
+        printf( "Failed to open %s for writing\n", path );
+        return false;
+    }
+    uint32 lastTick = 0;
+    bool success = writeHeader( file, log.seed, log.endTick, uint32( log.events.size() ) )
+                   && writeEvents( file, log.events.data(), log.events.size(), lastTick );
+    return fclose( file ) == 0 && success;
+}
+
+static void writeChunk( ReplayState* replay ) {
+    InputLog& log = replay->log;
+    if ( replay->recordFile == NULL || log.events.empty() ) {
+        return;
+    }
+    // A failed write leaves the stream's error flag set for ReplayFinishRecording to report
+    writeEvents( replay->recordFile, log.events.data(), log.events.size(), replay->lastTickWritten );
+    replay->eventsWritten += uint32( log.events.size() );
+    log.events.clear();
+}
+
+bool ReplayStartRecording( ReplayState* replay, const char* path ) {
+    replay->recordFile = fopen( path, "wb" );
+    if ( replay->recordFile == NULL ) {
+        printf( "Failed to open %s for writing\n", path );
+        return false;
+    }
+    // The header is a placeholder until the session ends. Writing it now also sets up the stream's buffer.
+    if ( !writeHeader( replay->recordFile, 0, 0, 0 ) ) {
+        printf( "Failed to write %s\n", path );
+        fclose( replay->recordFile );
+        replay->recordFile = NULL;
+        return false;
+    }
+    replay->recording = true;
+    replay->eventsWritten = 0;
+    replay->lastTickWritten = 0;
+    replay->log.events.clear();
+    replay->log.events.reserve( INPUT_LOG_CHUNK_EVENTS );
+    return true;
+}
+
+bool ReplayFinishRecording( ReplayState* replay ) {
+    FILE* file = replay->recordFile;
+    if ( file == NULL ) {
+        return false;
+    }
+    writeChunk( replay );
+    bool success = fseek( file, 0, SEEK_SET ) == 0
+                   && writeHeader( file, replay->log.seed, replay->log.endTick, replay->eventsWritten )
+                   && !ferror( file );
+    success = fclose( file ) == 0 && success;
+    replay->recordFile = NULL;
+    replay->recording = false;
+    return success;
+}
+
+bool LoadInputLog( const char* path, InputLog* log ) {
+    FILE* file = fopen( path, "rb" );
+    if ( file == NULL ) {
+        printf( "Failed to open %s\n", path );
+        return false;
+    }
+    std::vector<uint8> in;
+    uint8 buffer[4096];
+    size_t read;
+    while ( ( read = fread( buffer, 1, sizeof( buffer ), file ) ) > 0 ) {
+        in.insert( in.end(), buffer, buffer + read );
+    }
+    fclose( file );
+
+    size_t pos = 4;
+    uint64 version, seed, endTick, count;
+    if ( in.size() < 4 || memcmp( &in[0], INPUT_LOG_MAGIC, 4 ) != 0
+         || !readFixed( in, pos, version, 4 ) || version != INPUT_LOG_VERSION
+         || !readFixed( in, pos, seed, 8 ) || !readFixed( in, pos, endTick, 4 ) || !readFixed( in, pos, count, 4 ) ) {
+        printf( "%s is not a version %u input log\n", path, INPUT_LOG_VERSION );
+        return false;
+    }
+
+    log->seed = seed;
+    log->endTick = uint32( endTick );
+    log->events.clear();
+    uint32 tick = 0;
+    for ( uint64 i = 0; i < count; i++ ) {
+        uint32 delta = 0;
+        int shift = 0;
+        uint8 byte;
+        do {
+            if ( pos >= in.size() || shift > 28 ) {
+                printf( "%s is truncated\n", path );
+                return false;
+            }
+            byte = in[pos++];
+            delta |= uint32( byte & 0x7F ) << shift;
+            shift += 7;
+        } while ( byte & 0x80 );
+        if ( pos >= in.size() || in[pos] >= InputAction::COUNT ) {
+            printf( "%s is truncated\n", path );
+            return false;
+        }
+        tick += delta;
+        InputEvent event;
+        event.tick = tick;
+        event.action = in[pos++];
+        log->events.push_back( event );
+    }
+    return true;
+}
+
+GameInput ReplayTick( ReplayState* replay, uint32 tick, const GameInput& liveInput ) {
+    if ( replay->playing ) {
+        GameInput input = LogInputForTick( replay->log, replay->cursor, tick );
+        input.quit |= liveInput.quit;
+        return input;
+    }
+    if ( replay->recording ) {
+        // Write out the chunk first if this tick's actions might not fit in it
+        size_t actions = size_t( abs( liveInput.horizMove ) + liveInput.rotate + liveInput.turboOn + liveInput.turboOff
+                                 + liveInput.togglePause + liveInput.quit );
+        if ( replay->log.events.size() + actions > replay->log.events.capacity() ) {
+            writeChunk( replay );
+        }
+        RecordInput( &replay->log, tick, liveInput );
+        replay->log.endTick = tick + 1;
+    }
+    return liveInput;
+}
+
+bool ReplayFinished( const ReplayState* replay, uint32 tick ) {
+    return replay->playing && tick >= replay->log.endTick;
+}
+
+uint32 ReplayTicksUntilInput( const ReplayState* replay, uint32 tick ) {
+    if ( !replay->playing ) {
+        return NO_EVENT;
+    }
+    uint32 until = replay->log.endTick;
+    if ( replay->cursor < replay->log.events.size() && replay->log.events[replay->cursor].tick < until ) {
+        until = replay->log.events[replay->cursor].tick;
+    }
+    return until > tick ? until - tick : 0;
+}
+
+void ReplaySkipTicks( ReplayState* replay, uint32 tick, uint32 numTicks ) {
+    if ( replay->recording ) {
+        replay->log.endTick = tick + numTicks;
+    }
+}
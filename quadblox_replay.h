@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdio>
+#include <vector>
+#include "quadblox_engine.h"
+
+// Input recording and playback. A log is the seed plus every player action tagged with the tick that consumed it,
+// which is enough to re-run a session exactly with GameStep.
+
+namespace InputAction {
+    enum Enum : uint8 {
+        LEFT,
+        RIGHT,
+        ROTATE,
+        TURBO_ON,
+        TURBO_OFF,
+        PAUSE,
+        QUIT,
+        COUNT
+    };
+}
+
+typedef struct InputEvent {
+    uint32 tick;
+    uint8 action;
+} InputEvent;
+
+typedef struct InputLog {
+    uint64 seed = 0;
+    // Tick the recording stopped at, so playback runs the same length
+    uint32 endTick = 0;
+    std::vector<InputEvent> events;
+} InputLog;
+
+// Recording holds this many events in memory and writes them to the file whenever they fill up, so the log never
+// grows mid-game however long the session runs
+const size_t INPUT_LOG_CHUNK_EVENTS = 1 << 12;
+
+// Front end state for one session: record live input, play a log back, or neither
+typedef struct ReplayState {
+    InputLog log;
+    size_t cursor = 0;
+    bool recording = false;
+    bool playing = false;
+    // While recording: the log file, and the events and last tick already written to it
+    FILE* recordFile = NULL;
+    uint32 eventsWritten = 0;
+    uint32 lastTickWritten = 0;
+} ReplayState;
+
+void AddInputAction( GameInput* input, InputAction::Enum action );
+void RecordInput( InputLog* log, uint32 tick, const GameInput& input );
+// Every logged action for tick, merged into one GameInput. Events must be consumed in tick order.
+GameInput LogInputForTick( const InputLog& log, size_t& cursor, uint32 tick );
+
+// File format: "QBIL", version, seed, endTick, event count, then per event the tick delta as a LEB128 varint
+// followed by the action byte. All fixed-width fields are little endian.
+bool SaveInputLog( const char* path, const InputLog& log );
+bool LoadInputLog( const char* path, InputLog* log );
+// Record this session to path. The header is written again with the seed, end tick and event count once
+// ReplayFinishRecording flushes the last chunk and closes the file.
+bool ReplayStartRecording( ReplayState* replay, const char* path );
+bool ReplayFinishRecording( ReplayState* replay );
+
+// Input to step with this tick. Playback replaces live input, except that quitting still works.
+GameInput ReplayTick( ReplayState* replay, uint32 tick, const GameInput& liveInput );
+bool ReplayFinished( const ReplayState* replay, uint32 tick );
+// Ticks from tick on that playback has no input for, NO_EVENT when not playing
+uint32 ReplayTicksUntilInput( const ReplayState* replay, uint32 tick );
+// Account for idle ticks the game skipped instead of stepping through ReplayTick
+void ReplaySkipTicks( ReplayState* replay, uint32 tick, uint32 numTicks );
@@ -0,0 +1,49 @@
+#include <type_traits>
+#include "quadblox_rollback.h"
+
+static_assert( std::is_trivially_copyable<GameState>::value, "game state must copy with a memcpy" );
+
+static bool sameInput( const GameInput& a, const GameInput& b ) {
+    return a.horizMove == b.horizMove && a.rotate == b.rotate && a.turboOn == b.turboOn && a.turboOff == b.turboOff &&
+           a.togglePause == b.togglePause && a.quit == b.quit;
+}
+
+static void step( RollbackBuffer* buffer, GameState* gameState, const GameInput& input ) {
+    uint32 slot = gameState->tick % ROLLBACK_TICKS;
+    buffer->states[slot] = *gameState;
+    buffer->inputs[slot] = input;
+    GameStep( gameState, input );
+    if ( gameState->gameOver ) {
+        InitGame( gameState );
+    }
+}
+
+void RollbackStep( RollbackBuffer* buffer, GameState* gameState, const GameInput& input ) {
+    if ( gameState->tick != buffer->nextTick ) {
+        // First step, or the game was moved on some other way: nothing held is still on this timeline
+        buffer->firstTick = gameState->tick;
+    } else if ( buffer->nextTick - buffer->firstTick == ROLLBACK_TICKS ) {
+        buffer->firstTick++;
+    }
+    step( buffer, gameState, input );
+    buffer->nextTick = gameState->tick;
+}
+
+bool RollbackCorrect( RollbackBuffer* buffer, GameState* gameState, uint32 tick, const GameInput& input ) {
+    if ( tick < buffer->firstTick || tick >= buffer->nextTick || gameState->tick != buffer->nextTick ) {
+        return false;
+    }
+    uint32 slot = tick % ROLLBACK_TICKS;
+    if ( sameInput( buffer->inputs[slot], input ) ) {
+        return true;
+    }
+    buffer->rollbacks++;
+    *gameState = buffer->states[slot];
+    step( buffer, gameState, input );
+    buffer->resimulatedTicks++;
+    while ( gameState->tick < buffer->nextTick ) {
+        step( buffer, gameState, buffer->inputs[gameState->tick % ROLLBACK_TICKS] );
+        buffer->resimulatedTicks++;
+    }
+    return true;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "quadblox_engine.h"
+
+// Rollback for input that arrives late, as over a network. Each tick stepped through RollbackStep keeps the state
+// it started from and the input it was stepped with. When the real input for a held tick turns out to differ from
+// the prediction, RollbackCorrect restores that tick's state and steps forward again to the present.
+// GameState holds no pointers, so saving or restoring a tick is one fixed-size copy.
+
+const uint32 ROLLBACK_TICKS = 64;
+
+typedef struct RollbackBuffer {
+    // Slot tick % ROLLBACK_TICKS holds the state before tick stepped, and the input it stepped with
+    GameState states[ROLLBACK_TICKS];
+    GameInput inputs[ROLLBACK_TICKS];
+    // Ticks held are [firstTick, nextTick)
+    uint32 firstTick = 0;
+    uint32 nextTick = 0;
+
+    long long rollbacks = 0;
+    long long resimulatedTicks = 0;
+} RollbackBuffer;
+
+// Save gameState, then step it one tick. A game that tops out starts over on the same tick, so a rollback across
+// the restart replays it too. Ticks must be stepped one at a time, not skipped.
+void RollbackStep( RollbackBuffer* buffer, GameState* gameState, const GameInput& input );
+// The real input for tick. If it differs from the one tick was stepped with, rewind to tick and step back up to
+// the present. False if tick is no longer held, or has not been stepped yet.
+bool RollbackCorrect( RollbackBuffer* buffer, GameState* gameState, uint32 tick, const GameInput& input );
@@ -0,0 +1,461 @@
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "quadblox_server.h"
+#include "quadblox_ttable.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// Remote input waiting to be consumed, one byte per tick
+const int INBOX_SIZE = 256;
+// Remote slot taken by the acceptor, which is still greeting the client
+const int SLOT_RESERVED = -2;
+
+typedef struct ServerGame {
+    int id = 0;
+    GameState state;
+    BotSearchResult plan;
+    uint32 inputRng = 1;
+    // Client the worker last saw on this game, to greet a new one with the piece in play
+    int connectedFd = -1;
+    char inbox[INBOX_SIZE];
+    int inboxStart = 0;
+    int inboxEnd = 0;
+} ServerGame;
+
+typedef struct ServerShared {
+    const ServerOptions* options = NULL;
+    TranspositionTable* table = NULL;
+    // Client socket per remote game, -1 when there is none. The acceptor fills a free slot, the owning worker
+    // empties it when the client goes away.
+    std::vector< std::atomic<int> > remoteFds;
+    std::atomic<bool> running;
+    std::atomic<long long> clients;
+} ServerShared;
+
+typedef struct WorkerResult {
+    LatencyHistogram tickLatency;
+    long long gameTicks = 0;
+    long long gamesFinished = 0;
+    long long lines = 0;
+} WorkerResult;
+
+static bool sendText( int fd, const char* text, size_t length ) {
+    return send( fd, text, length, MSG_NOSIGNAL | MSG_DONTWAIT ) == ssize_t( length );
+}
+
+static bool sendPiece( int fd, const GameState& state ) {
+    const QuadBlock& qb = state.currentBlock;
+    char line[32 + 8 * PLAYAREA_HEIGHT];
+    int length = snprintf( line, sizeof( line ), "PIECE %u %d %d %d %d %d %d", state.tick, qb.blockType, qb.currentState,
+                           qb.x, qb.y, state.nextBlockType, state.linesCleared );
+    for ( int row = 0; row < PLAYAREA_HEIGHT; row++ ) {
+        length += snprintf( line + length, sizeof( line ) - size_t( length ), " %x", unsigned( state.blockBake[row] ) );
+    }
+    line[length++] = '\n';
+    return sendText( fd, line, size_t( length ) );
+}
+
+static GameInput remoteInput( char key ) {
+    GameInput input;
+    switch ( key ) {
+        case 'l': input.horizMove = -1; break;
+        case 'r': input.horizMove = 1; break;
+        case 'u': input.rotate = 1; break;
+        case 't': input.turboOn = true; break;
+        case 'T': input.turboOff = true; break;
+        default: break;
+    }
+    return input;
+}
+
+static GameInput randomInput( uint32& rng ) {
+    // xorshift32
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    GameInput input;
+    switch ( rng % 16 ) {
+        case 0: input.horizMove = -1; break;
+        case 1: input.horizMove = 1; break;
+        case 2: input.rotate = 1; break;
+        case 3: input.turboOn = true; break;
+        default: break;
+    }
+    return input;
+}
+
+static void dropClient( ServerShared* shared, ServerGame& game ) {
+    close( game.connectedFd );
+    game.connectedFd = -1;
+    shared->remoteFds[size_t( game.id )].store( -1 );
+}
+
+// Pull whatever the client sent into the inbox. Returns false if it hung up.
+static bool receiveInput( ServerGame& game ) {
+    if ( game.inboxStart == game.inboxEnd ) {
+        game.inboxStart = game.inboxEnd = 0;
+    }
+    if ( game.inboxEnd == INBOX_SIZE ) {
+        return true;
+    }
+    ssize_t received = recv( game.connectedFd, game.inbox + game.inboxEnd, size_t( INBOX_SIZE - game.inboxEnd ), MSG_DONTWAIT );
+    if ( received > 0 ) {
+        game.inboxEnd += int( received );
+        return true;
+    }
+    return received < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK );
+}
+
+static void serveShard( ServerShared* shared, int first, int count, WorkerResult* result ) {
+    const ServerOptions& options = *shared->options;
+    int upcoming[16];
+    int depth = options.depth < 0 ? 0 : ( options.depth > 16 ? 16 : options.depth );
+
+    // Allocated here rather than by the caller, so the shard is first touched by the core that runs it
+    std::vector<ServerGame> games;
+    games.resize( size_t( count ) );
+    for ( int i = 0; i < count; i++ ) {
+        ServerGame& game = games[size_t( i )];
+        game.id = first + i;
+        game.inputRng = uint32( game.id ) * 2654435761u | 1;
+        InitGame( &game.state );
+        // The seed's high half is folded in, so seeds past 32 bits still give their own games
+        SeedGame( &game.state, ( options.seed << 32 | uint64( game.id ) ) ^ ( options.seed >> 32 ) );
+    }
+
+    Clock::time_point start = Clock::now();
+    for ( long long round = 0; round < options.numTicks; round++ ) {
+        for ( ServerGame& game : games ) {
+            bool remote = game.id < options.numRemote;
+            if ( remote ) {
+                int fd = shared->remoteFds[size_t( game.id )].load();
+                if ( fd < 0 ) {
+                    continue;
+                }
+                if ( fd != game.connectedFd ) {
+                    game.connectedFd = fd;
+                    game.inboxStart = game.inboxEnd = 0;
+                    if ( game.state.hasCurrentBlock && !sendPiece( fd, game.state ) ) {
+                        dropClient( shared, game );
+                        continue;
+                    }
+                }
+            }
+
+            Clock::time_point tickStart = Clock::now();
+            GameState& state = game.state;
+            GameInput input;
+            if ( remote ) {
+                if ( !receiveInput( game ) ) {
+                    dropClient( shared, game );
+                    continue;
+                }
+                if ( game.inboxStart < game.inboxEnd ) {
+                    input = remoteInput( game.inbox[game.inboxStart++] );
+                }
+            } else if ( options.driver == GameDriver::RANDOM ) {
+                input = randomInput( game.inputRng );
+            } else if ( state.hasCurrentBlock ) {
+                if ( !game.plan.found ) {
+                    for ( int i = 0; i < depth; i++ ) {
+                        upcoming[i] = i == 0 ? state.nextBlockType : -1;
+                    }
+                    game.plan = BotSearch( state.blockBake, state.boardHash, state.metrics, state.currentBlock, upcoming,
+                                           depth, options.weights, NULL, shared->table );
+                }
+                if ( game.plan.found ) {
+                    input = BotInputToward( &state, game.plan.placement );
+                }
+            }
+
+            bool hadPiece = state.hasCurrentBlock;
+            GameStep( &state, input );
+            if ( !state.hasCurrentBlock ) {
+                game.plan.found = false;
+            }
+            bool connected = remote;
+            if ( connected && !hadPiece && state.hasCurrentBlock ) {
+                connected = sendPiece( game.connectedFd, state );
+            }
+            if ( state.gameOver ) {
+                if ( connected ) {
+                    char line[64];
+                    int length = snprintf( line, sizeof( line ), "OVER %u %d\n", state.tick, state.linesCleared );
+                    connected = sendText( game.connectedFd, line, size_t( length ) );
+                }
+                result->lines += state.linesCleared;
+                result->gamesFinished++;
+                InitGame( &state );
+            }
+            if ( remote && !connected ) {
+                dropClient( shared, game );
+            }
+
+            LatencyRecord( &result->tickLatency, uint64( std::chrono::duration_cast<std::chrono::nanoseconds>( Clock::now() - tickStart ).count() ) );
+            result->gameTicks++;
+        }
+
+        if ( options.realtime ) {
+            std::chrono::duration<double> elapsed( GAME_TICK_SECONDS * double( round + 1 ) );
+            std::this_thread::sleep_until( start + std::chrono::duration_cast<Clock::duration>( elapsed ) );
+        }
+    }
+
+    for ( ServerGame& game : games ) {
+        result->lines += game.state.linesCleared;
+        if ( game.id < options.numRemote ) {
+            int fd = shared->remoteFds[size_t( game.id )].exchange( -1 );
+            if ( fd >= 0 ) {
+                char line[32];
+                int length = snprintf( line, sizeof( line ), "END %u\n", game.state.tick );
+                sendText( fd, line, size_t( length ) );
+                close( fd );
+            }
+        }
+        InitGame( &game.state );
+    }
+}
+
+static int listenOn( const char* path ) {
+    int fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if ( fd < 0 ) {
+        perror( "socket" );
+        return -1;
+    }
+    sockaddr_un address;
+    memset( &address, 0, sizeof( address ) );
+    address.sun_family = AF_UNIX;
+    strncpy( address.sun_path, path, sizeof( address.sun_path ) - 1 );
+    unlink( path );
+    if ( bind( fd, (const sockaddr*)&address, sizeof( address ) ) != 0 || listen( fd, 64 ) != 0 ) {
+        perror( path );
+        close( fd );
+        return -1;
+    }
+    return fd;
+}
+
+static void acceptClients( ServerShared* shared, int listenFd ) {
+    const ServerOptions& options = *shared->options;
+    while ( shared->running.load() ) {
+        pollfd waitFor = { listenFd, POLLIN, 0 };
+        if ( poll( &waitFor, 1, 50 ) <= 0 ) {
+            continue;
+        }
+        int fd = accept( listenFd, NULL, NULL );
+        if ( fd < 0 ) {
+            continue;
+        }
+
+        int slot = -1;
+        for ( int i = 0; i < options.numRemote && slot < 0; i++ ) {
+            int expected = -1;
+            if ( shared->remoteFds[size_t( i )].compare_exchange_strong( expected, SLOT_RESERVED ) ) {
+                slot = i;
+            }
+        }
+        char line[32];
+        int length = slot < 0 ? snprintf( line, sizeof( line ), "FULL\n" ) : snprintf( line, sizeof( line ), "GAME %d\n", slot );
+        bool greeted = send( fd, line, size_t( length ), MSG_NOSIGNAL ) == ssize_t( length );
+        if ( slot < 0 || !greeted ) {
+            close( fd );
+            if ( slot >= 0 ) {
+                shared->remoteFds[size_t( slot )].store( -1 );
+            }
+            continue;
+        }
+        fcntl( fd, F_SETFL, fcntl( fd, F_GETFL ) | O_NONBLOCK );
+        shared->clients++;
+        // Hand the socket to the worker that owns the game
+        shared->remoteFds[size_t( slot )].store( fd );
+    }
+}
+
+bool RunServer( const ServerOptions& options, ServerStats* stats ) {
+    ServerOptions clamped = options;
+    clamped.numRemote = options.numRemote < options.numGames ? options.numRemote : options.numGames;
+    int numThreads = options.numThreads > 0 ? options.numThreads : int( std::thread::hardware_concurrency() );
+    numThreads = numThreads < 1 ? 1 : ( numThreads > options.numGames ? options.numGames : numThreads );
+
+    ServerShared shared;
+    shared.options = &clamped;
+    shared.remoteFds = std::vector< std::atomic<int> >( size_t( clamped.numRemote ) );
+    for ( std::atomic<int>& fd : shared.remoteFds ) {
+        fd.store( -1 );
+    }
+    shared.running.store( true );
+    shared.clients.store( 0 );
+
+    int listenFd = -1;
+    if ( clamped.numRemote > 0 ) {
+        if ( options.socketPath == NULL ) {
+            printf( "Remote games need a socket path\n" );
+            return false;
+        }
+        listenFd = listenOn( options.socketPath );
+        if ( listenFd < 0 ) {
+            return false;
+        }
+    }
+    std::thread acceptor;
+    if ( listenFd >= 0 ) {
+        acceptor = std::thread( acceptClients, &shared, listenFd );
+    }
+
+    if ( options.driver == GameDriver::BOT && options.tableBytes > 0 ) {
+        shared.table = new TranspositionTable( options.tableBytes );
+    }
+    std::vector<WorkerResult> results;
+    results.resize( size_t( numThreads ) );
+    std::vector<std::thread> workers;
+    Clock::time_point start = Clock::now();
+    for ( int i = 0; i < numThreads; i++ ) {
+        int first = int( (long long)options.numGames * i / numThreads );
+        int last = int( (long long)options.numGames * ( i + 1 ) / numThreads );
+        workers.push_back( std::thread( serveShard, &shared, first, last - first, &results[size_t( i )] ) );
+    }
+    for ( std::thread& worker : workers ) {
+        worker.join();
+    }
+    stats->seconds = std::chrono::duration<double>( Clock::now() - start ).count();
+
+    shared.running.store( false );
+    if ( acceptor.joinable() ) {
+        acceptor.join();
+        close( listenFd );
+        unlink( options.socketPath );
+    }
+
+    stats->numThreads = numThreads;
+    stats->clients = shared.clients.load();
+    if ( shared.table ) {
+        stats->tableProbes = shared.table->Probes();
+        stats->tableHits = shared.table->Hits();
+        delete shared.table;
+    }
+    for ( const WorkerResult& result : results ) {
+        stats->gameTicks += result.gameTicks;
+        stats->gamesFinished += result.gamesFinished;
+        stats->lines += result.lines;
+        LatencyMerge( &stats->tickLatency, result.tickLatency );
+    }
+    return true;
+}
+
+void PrintServerStats( const ServerStats& stats ) {
+    printf( "%lld game-ticks on %d threads in %.3fs: %.0f game-ticks/s, %lld games finished, %lld lines, %lld clients\n",
+            stats.gameTicks, stats.numThreads, stats.seconds, double( stats.gameTicks ) / stats.seconds,
+            stats.gamesFinished, stats.lines, stats.clients );
+    const LatencyHistogram& latency = stats.tickLatency;
+    printf( "per-game tick latency: p50 %.2fus, p99 %.2fus, p99.9 %.2fus, max %.2fus\n",
+            double( LatencyPercentile( latency, 0.5 ) ) / 1000.0, double( LatencyPercentile( latency, 0.99 ) ) / 1000.0,
+            double( LatencyPercentile( latency, 0.999 ) ) / 1000.0, double( latency.max ) / 1000.0 );
+    if ( stats.tableProbes > 0 ) {
+        printf( "transposition table: %llu probes, %.1f%% hits\n", (unsigned long long)stats.tableProbes,
+                100.0 * double( stats.tableHits ) / double( stats.tableProbes ) );
+    }
+}
+
+bool RunClient( const char* socketPath, const BotWeights& weights ) {
+    int fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+    sockaddr_un address;
+    memset( &address, 0, sizeof( address ) );
+    address.sun_family = AF_UNIX;
+    strncpy( address.sun_path, socketPath, sizeof( address.sun_path ) - 1 );
+    if ( fd < 0 || connect( fd, (const sockaddr*)&address, sizeof( address ) ) != 0 ) {
+        perror( socketPath );
+        if ( fd >= 0 ) {
+            close( fd );
+        }
+        return false;
+    }
+    // Lines are read through stdio on a duplicate, keys written straight to fd
+    int readFd = dup( fd );
+    FILE* in = readFd < 0 ? NULL : fdopen( readFd, "r" );
+    if ( in == NULL ) {
+        perror( socketPath );
+        if ( readFd >= 0 ) {
+            close( readFd );
+        }
+        close( fd );
+        return false;
+    }
+
+    long long pieces = 0;
+    long long games = 0;
+    int lines = 0;
+    char line[32 + 8 * PLAYAREA_HEIGHT];
+    while ( fgets( line, sizeof( line ), in ) != NULL ) {
+        if ( strncmp( line, "GAME", 4 ) == 0 || strncmp( line, "FULL", 4 ) == 0 || strncmp( line, "END", 3 ) == 0 ) {
+            printf( "client: %s", line );
+            if ( line[0] != 'G' ) {
+                break;
+            }
+            continue;
+        }
+        if ( strncmp( line, "OVER", 4 ) == 0 ) {
+            games++;
+            continue;
+        }
+        if ( strncmp( line, "PIECE", 5 ) != 0 ) {
+            continue;
+        }
+
+        unsigned tick;
+        int blockType, state, x, y, next;
+        int consumed = 0;
+        if ( sscanf( line, "PIECE %u %d %d %d %d %d %d%n", &tick, &blockType, &state, &x, &y, &next, &lines, &consumed ) != 7 ) {
+            continue;
+        }
+        GameBlocks board;
+        char* cursor = line + consumed;
+        for ( int row = 0; row < PLAYAREA_HEIGHT; row++ ) {
+            board[row] = uint16( strtoul( cursor, &cursor, 16 ) );
+        }
+        QuadBlock qb;
+        qb.blockType = blockType;
+        qb.currentState = 0;
+        RotateBlock( qb, state );
+        qb.x = x;
+        qb.y = y;
+
+        int upcoming[1] = { next };
+        GameMetrics metrics;
+        BoardMetricsFromRows( &metrics, board );
+        BotSearchResult plan = BotSearch( board, BoardHash( board ), metrics, qb, upcoming, 1, weights, NULL, NULL );
+        if ( !plan.found ) {
+            continue;
+        }
+
+        // One key per tick, in BotInputToward's order. Each rotation snaps into the play area as updateGame does.
+        std::string keys;
+        while ( qb.state != BLOCKS[qb.blockType][plan.placement.state] ) {
+            RotateBlock( qb, 1 );
+            const BlockOnBoard<PLAYAREA_WIDTH>& onBoard = OnBoard( qb );
+            qb.x = qb.x < onBoard.minX ? onBoard.minX : ( qb.x > onBoard.maxX ? onBoard.maxX : qb.x );
+            keys += 'u';
+        }
+        keys.append( size_t( abs( plan.placement.x - qb.x ) ), plan.placement.x < qb.x ? 'l' : 'r' );
+        keys += 't';
+        if ( write( fd, keys.data(), keys.size() ) != ssize_t( keys.size() ) ) {
+            break;
+        }
+        pieces++;
+    }
+    printf( "client: %lld pieces placed, %lld games over, %d lines in the last game\n", pieces, games, lines );
+    fclose( in );
+    close( fd );
+    return true;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "quadblox_engine.h"
+#include "quadblox_bot.h"
+#include "quadblox_latency.h"
+
+// Multi-game host. Games are split into one contiguous shard per worker thread, and a game never leaves its
+// worker, so its state stays in that core's cache. Each round a worker steps every game in its shard once.
+// Games are driven by the built-in bot or random input, except the first numRemote, which take input from
+// clients on a Unix socket.
+//
+// Protocol, all lines end in '\n':
+//   server: GAME <id>                 sent once on connect, or FULL when every remote game has a client
+//   server: PIECE <tick> <type> <state> <x> <y> <next> <lines> <row 0> ... <row PLAYAREA_HEIGHT-1>
+//                                     whenever a piece spawns, rows as hex bitmasks
+//   server: OVER <tick> <lines>       the game topped out and starts again
+//   server: END <tick>                the server is done, the connection closes
+//   client: single bytes, one consumed per tick: l r (move) u (rotate) t T (turbo on/off)
+
+namespace GameDriver {
+    enum Enum {
+        RANDOM,
+        BOT,
+        COUNT
+    };
+}
+
+typedef struct ServerOptions {
+    int numGames = 1000;
+    // 0 is one worker per core
+    int numThreads = 0;
+    // Ticks each game runs for
+    long long numTicks = 10000;
+    uint64 seed = 1;
+    GameDriver::Enum driver = GameDriver::BOT;
+    int depth = 1;
+    BotWeights weights;
+    // Transposition table shared by every worker's bot search, 0 for none
+    size_t tableBytes = 16 << 20;
+    // Games [0, numRemote) are played by socket clients, and fall idle while none is connected
+    int numRemote = 0;
+    const char* socketPath = NULL;
+    // Pace rounds at GAME_TICK_SECONDS, as players would see them, instead of running flat out
+    bool realtime = false;
+} ServerOptions;
+
+typedef struct ServerStats {
+    int numThreads = 0;
+    long long gameTicks = 0;
+    long long gamesFinished = 0;
+    long long lines = 0;
+    long long clients = 0;
+    double seconds = 0;
+    uint64 tableProbes = 0;
+    uint64 tableHits = 0;
+    // Time to step one game by one tick, input and bot search included
+    LatencyHistogram tickLatency;
+} ServerStats;
+
+bool RunServer( const ServerOptions& options, ServerStats* stats );
+void PrintServerStats( const ServerStats& stats );
+
+// Stand-in client: connects to a server, plays its game with the bot until the server hangs up.
+// Returns false if it could not connect.
+bool RunClient( const char* socketPath, const BotWeights& weights );
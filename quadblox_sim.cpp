@@ -0,0 +1,113 @@
+#include <cstdio>
+#include "quadblox_alloc.h"
+#include "quadblox_profile.h"
+#include "quadblox_sim.h"
+
+static void publish( Simulation* sim, const QuadBlock* from, Uint64 stepTime ) {
+    TakeSnapshot( sim->gameState, from, stepTime, sim->snapshots.Back() );
+    sim->snapshots.Publish();
+}
+
+void SimulationInit( Simulation* sim, InputQueue* input, ReplayState* replay, Uint64 now ) {
+    sim->input = input;
+    sim->replay = replay;
+    sim->tickPeriod = Uint64( double( SDL_GetPerformanceFrequency() ) * GAME_TICK_SECONDS );
+    sim->lastNow = now;
+    sim->accumulator = 0;
+    publish( sim, NULL, now );
+}
+
+void SimulateUntil( Simulation* sim, Uint64 now ) {
+    GameState* gameState = &sim->gameState;
+    InputQueue* input = sim->input;
+    ReplayState* replay = sim->replay;
+    Uint64 tickPeriod = sim->tickPeriod;
+    sim->accumulator += now - sim->lastNow;
+    sim->lastNow = now;
+
+    uint32 dueTicks = uint32( sim->accumulator / tickPeriod );
+    sim->accumulator -= Uint64( dueTicks ) * tickPeriod;
+    if ( dueTicks == 0 ) {
+        return;
+    }
+    sim->batches++;
+    if ( dueTicks > sim->maxBatch ) {
+        sim->maxBatch = dueTicks;
+    }
+    // When the first due tick fell. Presses stamped up to a tick's time are applied on that tick.
+    Uint64 tickTime = now - sim->accumulator - Uint64( dueTicks - 1 ) * tickPeriod;
+
+    // The piece before the last step, for the renderer to slide from
+    QuadBlock from;
+    bool hasFrom = false;
+    Uint64 stepTime = tickTime;
+    while ( dueTicks > 0 ) {
+        if ( ReplayFinished( replay, gameState->tick ) ) {
+            // Hold the final position, but still let the player quit
+            while ( InputQueueTicksUntilInput( input, now, tickPeriod ) == 0 ) {
+                gameState->wantsToQuit |= InputQueueTake( input, now ).quit;
+            }
+            break;
+        }
+        GameInput tickInput = InputQueueTake( input, tickTime );
+        // Nothing to apply: jump straight to the next tick where something happens
+        if ( InputIsEmpty( tickInput ) ) {
+            uint32 idle = GameTicksUntilEvent( gameState );
+            uint32 untilReplay = ReplayTicksUntilInput( replay, gameState->tick );
+            uint32 untilQueued = InputQueueTicksUntilInput( input, tickTime, tickPeriod );
+            if ( untilReplay < idle ) idle = untilReplay;
+            if ( untilQueued < idle ) idle = untilQueued;
+            if ( dueTicks < idle ) idle = dueTicks;
+            ReplaySkipTicks( replay, gameState->tick, idle );
+            GameSkipTicks( gameState, idle );
+            dueTicks -= idle;
+            tickTime += Uint64( idle ) * tickPeriod;
+            if ( dueTicks == 0 ) {
+                break;
+            }
+            if ( idle > 0 ) {
+                tickInput = InputQueueTake( input, tickTime );
+            }
+        }
+        hasFrom = gameState->hasCurrentBlock;
+        if ( hasFrom ) {
+            from = gameState->currentBlock;
+        }
+        stepTime = tickTime;
+        {
+            ProfileScope scope( ProfileStage::UPDATE );
+            GameStep( gameState, ReplayTick( replay, gameState->tick, tickInput ) );
+        }
+        // Topping out starts the next game straight away, as headless does, so a replay of the session matches
+        if ( gameState->gameOver ) {
+            InitGame( gameState );
+            sim->gamesFinished++;
+        }
+        dueTicks--;
+        tickTime += tickPeriod;
+    }
+
+    publish( sim, hasFrom ? &from : NULL, stepTime );
+}
+
+void RunSimulation( Simulation* sim ) {
+    Uint64 perfFreq = SDL_GetPerformanceFrequency();
+    if ( sim->profiler ) {
+        ProfileThreadBegin( sim->profiler, "simulation" );
+    }
+    while ( sim->running.load( std::memory_order_relaxed ) && !sim->gameState.wantsToQuit ) {
+        uint64 allocations = AllocationsOnThread();
+        SimulateUntil( sim, SDL_GetPerformanceCounter() );
+        sim->allocations += AllocationsOnThread() - allocations;
+        // Sleep to the next tick. Presses are stamped on arrival, so waking late delays them but can't reorder them.
+        Uint64 sinceTick = sim->accumulator + ( SDL_GetPerformanceCounter() - sim->lastNow );
+        if ( sinceTick < sim->tickPeriod ) {
+            SDL_Delay( Uint32( ( sim->tickPeriod - sinceTick ) * 1000 / perfFreq ) );
+        }
+    }
+}
+
+void SimulationPrintStats( const Simulation* sim ) {
+    printf( "Simulation: %u ticks in %lld batches, at most %u ticks caught up at once, %llu heap allocations, %d games finished\n",
+            sim->gameState.tick, sim->batches, sim->maxBatch, (unsigned long long)sim->allocations, sim->gamesFinished );
+}
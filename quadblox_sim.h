@@ -0,0 +1,46 @@
+#pragma once
+#include <atomic>
+#include "SDL.h"
+#include "quadblox_engine.h"
+#include "quadblox_input.h"
+#include "quadblox_replay.h"
+#include "quadblox_snapshot.h"
+
+struct Profiler;
+
+// The game steps on its own thread, waking once per tick, and publishes a snapshot after each batch of steps.
+// The render loop draws whichever snapshot is newest, so a slow present never holds up a tick and a burst of
+// catch-up ticks never holds up a frame.
+typedef struct Simulation {
+    GameState gameState;
+    InputQueue* input = NULL;
+    ReplayState* replay = NULL;
+    TripleBuffer<GameSnapshot> snapshots;
+    // Cleared by the render loop to stop the thread before the game quits
+    std::atomic<bool> running;
+    // Steps are timed into a ring of their own here, if set before the thread starts
+    Profiler* profiler = NULL;
+
+    Uint64 tickPeriod = 0;
+    Uint64 lastNow = 0;
+    Uint64 accumulator = 0;
+
+    // Batches of steps run, and the most ticks one batch had to catch up on
+    long long batches = 0;
+    uint32 maxBatch = 0;
+    // Heap allocations made while simulating, which should stay at zero
+    uint64 allocations = 0;
+    // Games that topped out and were restarted
+    int gamesFinished = 0;
+
+    Simulation() : running( true ) {}
+} Simulation;
+
+// Set up a simulation of an already seeded gameState and publish its first snapshot, as of now
+void SimulationInit( Simulation* sim, InputQueue* input, ReplayState* replay, Uint64 now );
+// Runs every whole tick elapsed up to now, a performance counter reading, then publishes a snapshot. Each queued
+// press is consumed by the tick its timestamp falls in, and is recorded to or replaced from the replay log.
+void SimulateUntil( Simulation* sim, Uint64 now );
+// Thread body: simulate in real time until the game quits or running is cleared
+void RunSimulation( Simulation* sim );
+void SimulationPrintStats( const Simulation* sim );
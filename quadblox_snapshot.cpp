@@ -0,0 +1,27 @@
+#include <cstring>
+#include "quadblox_snapshot.h"
+
+void TakeSnapshot( const GameState& gameState, const QuadBlock* from, uint64 stepTime, GameSnapshot* snapshot ) {
+    snapshot->tick = gameState.tick;
+    snapshot->hasPiece = gameState.hasCurrentBlock;
+    if ( snapshot->hasPiece ) {
+        const QuadBlock& qb = gameState.currentBlock;
+        snapshot->piece = qb;
+        bool slid = from != NULL && from->blockType == qb.blockType && from->currentState == qb.currentState &&
+                    from->x - qb.x <= 1 && qb.x - from->x <= 1 && from->y - qb.y <= 1 && qb.y - from->y <= 1;
+        snapshot->fromX = slid ? from->x : qb.x;
+        snapshot->fromY = slid ? from->y : qb.y;
+    }
+    snapshot->stepTime = stepTime;
+    snapshot->nextBlockType = gameState.nextBlockType;
+    snapshot->linesCleared = gameState.linesCleared;
+    memcpy( snapshot->blockBake, gameState.blockBake, sizeof( snapshot->blockBake ) );
+    memcpy( snapshot->blockColor, gameState.blockColor, sizeof( snapshot->blockColor ) );
+    memcpy( snapshot->rowVersion, gameState.rowVersion, sizeof( snapshot->rowVersion ) );
+    snapshot->numCompleteRows = gameState.numCompleteRows;
+    memcpy( snapshot->completeRows, gameState.completeRows, sizeof( snapshot->completeRows ) );
+    snapshot->flashOn = gameState.flashOn;
+    snapshot->paused = gameState.paused;
+    snapshot->gameOver = gameState.gameOver;
+    snapshot->wantsToQuit = gameState.wantsToQuit;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include "quadblox_engine.h"
+
+// Everything a renderer reads of a classic game, copied out after a batch of steps so it can be drawn on another
+// thread while the game keeps stepping
+typedef struct GameSnapshot {
+    uint32 tick = 0;
+    bool hasPiece = false;
+    QuadBlock piece = { 0, 0, 0, 0, 0 };
+    // Where the piece was before the last step, so it can be drawn sliding between the two. Same as the piece
+    // when it spawned, rotated or jumped more than a cell.
+    int fromX = 0;
+    int fromY = 0;
+    // When the last step was due, on the publisher's clock
+    uint64 stepTime = 0;
+    int nextBlockType = -1;
+    int linesCleared = 0;
+    GameBlocks blockBake = { 0 };
+    GameColors blockColor;
+    uint32 rowVersion[PLAYAREA_HEIGHT] = { 0 };
+    int numCompleteRows = 0;
+    int completeRows[4] = { 0, 0, 0, 0 };
+    bool flashOn = false;
+    bool paused = false;
+    bool gameOver = false;
+    bool wantsToQuit = false;
+} GameSnapshot;
+
+// Copy gameState into snapshot. from is the piece before the last step, or NULL if there was none.
+void TakeSnapshot( const GameState& gameState, const QuadBlock* from, uint64 stepTime, GameSnapshot* snapshot );
+
+// One writer thread hands whole values to one reader thread. The writer fills the back slot and publishes it,
+// the reader picks up the newest published slot. Neither side waits, and the reader never sees a half-written
+// value; values published faster than they are read are simply skipped.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : back( 0 ), front( 1 ), middle( 2 ) {}
+
+    // Writer only. The slot to fill before the next Publish.
+    T* Back() { return &slots[back]; }
+    void Publish() {
+        back = middle.exchange( back | FRESH, std::memory_order_acq_rel ) & INDEX;
+    }
+
+    // Reader only. The newest published value, or the same one as last time if nothing new was published.
+    const T* Latest() {
+        if ( middle.load( std::memory_order_relaxed ) & FRESH ) {
+            front = middle.exchange( front, std::memory_order_acq_rel ) & INDEX;
+        }
+        return &slots[front];
+    }
+
+private:
+    static const uint32 INDEX = 3;
+    static const uint32 FRESH = 4;
+
+    T slots[3];
+    uint32 back;
+    uint32 front;
+    // Slot between the two sides, tagged FRESH while it holds a value the reader has not taken
+    alignas( 64 ) std::atomic<uint32> middle;
+};
@@ -0,0 +1,99 @@
+#include "quadblox_sprites.h"
+
+const int ATLAS_PADDING = 1;
+
+void SpriteBatchInit( SpriteBatch* batch ) {
+    for ( int i = 0; i < SPRITE_BATCH_MAX_QUADS; i++ ) {
+        int* quad = &batch->indices[i * 6];
+        int first = i * 4;
+        quad[0] = first;
+        quad[1] = first + 1;
+        quad[2] = first + 2;
+        quad[3] = first + 2;
+        quad[4] = first + 1;
+        quad[5] = first + 3;
+    }
+    batch->numQuads = 0;
+    batch->texture = NULL;
+}
+
+void SpriteBatchBegin( SpriteBatch* batch, SDL_Texture* texture, int textureWidth, int textureHeight ) {
+    batch->texture = texture;
+    batch->invTextureWidth = 1.0f / float(textureWidth);
+    batch->invTextureHeight = 1.0f / float(textureHeight);
+    batch->numQuads = 0;
+}
+
+static void setVertex( SDL_Vertex& vertex, float x, float y, float u, float v, SDL_Color color ) {
+    vertex.position.x = x;
+    vertex.position.y = y;
+    vertex.tex_coord.x = u;
+    vertex.tex_coord.y = v;
+    vertex.color = color;
+}
+
+void SpriteBatchQuad( SpriteBatch* batch, SDL_Renderer* renderer, const SDL_Rect& src, const SDL_Rect& dst, SDL_Color color ) {
+    if ( batch->numQuads == SPRITE_BATCH_MAX_QUADS ) {
+        SpriteBatchFlush( batch, renderer );
+    }
+
+    float u0 = float(src.x) * batch->invTextureWidth;
+    float v0 = float(src.y) * batch->invTextureHeight;
+    float u1 = float(src.x + src.w) * batch->invTextureWidth;
+    float v1 = float(src.y + src.h) * batch->invTextureHeight;
+    float x0 = float(dst.x);
+    float y0 = float(dst.y);
+    float x1 = float(dst.x + dst.w);
+    float y1 = float(dst.y + dst.h);
+
+    SDL_Vertex* quad = &batch->vertices[batch->numQuads * 4];
+    setVertex( quad[0], x0, y0, u0, v0, color );
+    setVertex( quad[1], x1, y0, u1, v0, color );
+    setVertex( quad[2], x0, y1, u0, v1, color );
+    setVertex( quad[3], x1, y1, u1, v1, color );
+    batch->numQuads++;
+}
+
+void SpriteBatchFlush( SpriteBatch* batch, SDL_Renderer* renderer ) {
+    if ( batch->numQuads > 0 ) {
+        SDL_RenderGeometry( renderer, batch->texture, batch->vertices, batch->numQuads * 4, batch->indices, batch->numQuads * 6 );
+    }
+    batch->numQuads = 0;
+}
+
+SDL_Surface* PackAtlas( SDL_Surface* const* surfaces, int count, SDL_Rect* outRects ) {
+    int width = 0;
+    int height = 0;
+    for ( int i = 0; i < count; i++ ) {
+        width += surfaces[i]->w + 2 * ATLAS_PADDING;
+        if ( surfaces[i]->h + 2 * ATLAS_PADDING > height ) {
+            height = surfaces[i]->h + 2 * ATLAS_PADDING;
+        }
+    }
+
+    SDL_Surface* atlas = SDL_CreateRGBSurfaceWithFormat( 0, width, height, 32, SDL_PIXELFORMAT_RGBA32 );
+    if ( atlas == NULL ) {
+        return NULL;
+    }
+    SDL_FillRect( atlas, NULL, SDL_MapRGBA( atlas->format, 0, 0, 0, 0 ) );
+
+    int x = 0;
+    for ( int i = 0; i < count; i++ ) {
+        // Copy alpha as-is instead of blending onto the transparent background
+        SDL_SetSurfaceBlendMode( surfaces[i], SDL_BLENDMODE_NONE );
+        // Offset copies first fill the border with the image's edge pixels, then the centred copy goes on top
+        for ( int dy = -ATLAS_PADDING; dy <= ATLAS_PADDING; dy += ATLAS_PADDING ) {
+            for ( int dx = -ATLAS_PADDING; dx <= ATLAS_PADDING; dx += ATLAS_PADDING ) {
+                SDL_Rect dst = { x + ATLAS_PADDING + dx, ATLAS_PADDING + dy, surfaces[i]->w, surfaces[i]->h };
+                if ( dx != 0 || dy != 0 ) {
+                    SDL_BlitSurface( surfaces[i], NULL, atlas, &dst );
+                }
+            }
+        }
+        SDL_Rect dst = { x + ATLAS_PADDING, ATLAS_PADDING, surfaces[i]->w, surfaces[i]->h };
+        SDL_BlitSurface( surfaces[i], NULL, atlas, &dst );
+        outRects[i] = dst;
+        x += surfaces[i]->w + 2 * ATLAS_PADDING;
+    }
+    return atlas;
+}
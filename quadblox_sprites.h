@@ -0,0 +1,28 @@
+#pragma once
+#include "SDL.h"
+
+// Quads from one texture, collected into a single vertex/index buffer and drawn with one SDL_RenderGeometry call.
+
+const int SPRITE_BATCH_MAX_QUADS = 1024;
+
+typedef struct SpriteBatch {
+    SDL_Texture* texture = NULL;
+    float invTextureWidth = 0;
+    float invTextureHeight = 0;
+    int numQuads = 0;
+    SDL_Vertex vertices[SPRITE_BATCH_MAX_QUADS * 4];
+    // Same two-triangle pattern for every quad, filled once
+    int indices[SPRITE_BATCH_MAX_QUADS * 6];
+} SpriteBatch;
+
+void SpriteBatchInit( SpriteBatch* batch );
+// Start collecting quads that sample texture, which is textureWidth x textureHeight pixels
+void SpriteBatchBegin( SpriteBatch* batch, SDL_Texture* texture, int textureWidth, int textureHeight );
+// src is in texture pixels, dst in viewport pixels. The texel is multiplied by color. Flushes when the batch is full.
+void SpriteBatchQuad( SpriteBatch* batch, SDL_Renderer* renderer, const SDL_Rect& src, const SDL_Rect& dst, SDL_Color color );
+void SpriteBatchFlush( SpriteBatch* batch, SDL_Renderer* renderer );
+
+// Pack surfaces side by side into one RGBA surface. Each gets a border of its own edge pixels, so linear filtering
+// at the edges of a quad doesn't bleed in its neighbours. Writes where each one landed to outRects.
+// The caller frees the result.
+SDL_Surface* PackAtlas( SDL_Surface* const* surfaces, int count, SDL_Rect* outRects );
@@ -0,0 +1,45 @@
+#pragma once
+#include <atomic>
+#include "quadblox_engine.h"
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread. N must be a power of two.
+// Each side owns one index and only reads the other's, so neither ever waits on the other.
+template <typename T, uint32 N>
+class SpscRing {
+    static_assert( N > 0 && ( N & ( N - 1 ) ) == 0, "ring size must be a power of two" );
+
+public:
+    SpscRing() : head( 0 ), tail( 0 ) {}
+
+    // Producer only. False when the ring is full and item was not queued.
+    bool Push( const T& item ) {
+        uint32 h = head.load( std::memory_order_relaxed );
+        if ( h - tail.load( std::memory_order_acquire ) == N ) {
+            return false;
+        }
+        items[h & ( N - 1 )] = item;
+        head.store( h + 1, std::memory_order_release );
+        return true;
+    }
+
+    // Consumer only. Copies the oldest item without removing it, false when the ring is empty.
+    bool Peek( T* out ) const {
+        uint32 t = tail.load( std::memory_order_relaxed );
+        if ( head.load( std::memory_order_acquire ) == t ) {
+            return false;
+        }
+        *out = items[t & ( N - 1 )];
+        return true;
+    }
+
+    // Consumer only. Drops the item Peek returned.
+    void Pop() {
+        tail.store( tail.load( std::memory_order_relaxed ) + 1, std::memory_order_release );
+    }
+
+private:
+    T items[N];
+    // Next slot to write, and next slot to read, on separate cache lines so the two threads don't share one
+    alignas( 64 ) std::atomic<uint32> head;
+    alignas( 64 ) std::atomic<uint32> tail;
+};
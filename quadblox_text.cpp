@@ -0,0 +1,84 @@
+#include "quadblox_text.h"
+
+SDL_Surface* RasterizeGlyphs( TTF_Font* font, GlyphAtlas* atlas ) {
+    SDL_Color white = { 0xFF, 0xFF, 0xFF, 0xFF };
+    SDL_Surface* surfaces[GLYPH_COUNT] = { NULL };
+    bool success = true;
+
+    for ( int i = 0; i < GLYPH_COUNT && success; i++ ) {
+        Uint16 ch = Uint16( GLYPH_FIRST + i );
+        surfaces[i] = TTF_RenderGlyph_Blended( font, ch, white );
+        int minx, maxx, miny, maxy;
+        if ( surfaces[i] == NULL || TTF_GlyphMetrics( font, ch, &minx, &maxx, &miny, &maxy, &atlas->advance[i] ) != 0 ) {
+            printf( "Failed to render glyph '%c': %s\n", char(ch), TTF_GetError() );
+            success = false;
+        }
+    }
+
+    SDL_Surface* packed = NULL;
+    if ( success ) {
+        packed = PackAtlas( surfaces, GLYPH_COUNT, atlas->rects );
+        atlas->lineSkip = TTF_FontLineSkip( font );
+    }
+    if ( packed == NULL ) {
+        printf( "Failed to build glyph atlas: %s\n", SDL_GetError() );
+    }
+
+    for ( int i = 0; i < GLYPH_COUNT; i++ ) {
+        if ( surfaces[i] ) {
+            SDL_FreeSurface( surfaces[i] );
+        }
+    }
+    return packed;
+}
+
+bool UploadGlyphAtlas( SDL_Renderer* renderer, SDL_Surface* packed, GlyphAtlas* atlas ) {
+    atlas->texture = SDL_CreateTextureFromSurface( renderer, packed );
+    atlas->width = packed->w;
+    atlas->height = packed->h;
+    SDL_FreeSurface( packed );
+    if ( atlas->texture == NULL ) {
+        printf( "Failed to upload glyph atlas: %s\n", SDL_GetError() );
+        return false;
+    }
+    SDL_SetTextureBlendMode( atlas->texture, SDL_BLENDMODE_BLEND );
+    return true;
+}
+
+bool BuildGlyphAtlas( SDL_Renderer* renderer, TTF_Font* font, GlyphAtlas* atlas ) {
+    SDL_Surface* packed = RasterizeGlyphs( font, atlas );
+    return packed != NULL && UploadGlyphAtlas( renderer, packed, atlas );
+}
+
+void FreeGlyphAtlas( GlyphAtlas* atlas ) {
+    if ( atlas->texture ) {
+        SDL_DestroyTexture( atlas->texture );
+    }
+    atlas->texture = NULL;
+}
+
+int DrawText( SDL_Renderer* renderer, SpriteBatch* batch, const GlyphAtlas* atlas, const char* text, int x, int y, SDL_Color color ) {
+    int penX = x;
+    for ( const char* c = text; *c; c++ ) {
+        int index = int(*c) - GLYPH_FIRST;
+        if ( index < 0 || index >= GLYPH_COUNT ) {
+            continue;
+        }
+        const SDL_Rect& src = atlas->rects[index];
+        SDL_Rect dst = { penX, y, src.w, src.h };
+        SpriteBatchQuad( batch, renderer, src, dst, color );
+        penX += atlas->advance[index];
+    }
+    return penX - x;
+}
+
+int MeasureText( const GlyphAtlas* atlas, const char* text ) {
+    int width = 0;
+    for ( const char* c = text; *c; c++ ) {
+        int index = int(*c) - GLYPH_FIRST;
+        if ( index >= 0 && index < GLYPH_COUNT ) {
+            width += atlas->advance[index];
+        }
+    }
+    return width;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "SDL.h"
+#include "SDL_ttf.h"
+#include "quadblox_sprites.h"
+
+// Printable ASCII rasterized once into an atlas, so drawing a string is a few quads in a SpriteBatch
+// instead of a TTF render, a surface and a texture upload.
+
+const int GLYPH_FIRST = 32;
+const int GLYPH_LAST = 126;
+const int GLYPH_COUNT = GLYPH_LAST - GLYPH_FIRST + 1;
+
+typedef struct GlyphAtlas {
+    SDL_Texture* texture = NULL;
+    int width = 0;
+    int height = 0;
+    // Each glyph's cell in the atlas, a full line high, with the glyph at its pen position
+    SDL_Rect rects[GLYPH_COUNT];
+    int advance[GLYPH_COUNT];
+    int lineSkip = 0;
+} GlyphAtlas;
+
+// Glyphs are rendered white, so the colour passed to DrawText tints them
+bool BuildGlyphAtlas( SDL_Renderer* renderer, TTF_Font* font, GlyphAtlas* atlas );
+// The same in two halves, so rasterizing can run on a worker thread while only the upload needs the render thread.
+// RasterizeGlyphs fills in the metrics and returns the packed atlas surface, NULL on failure.
+// UploadGlyphAtlas frees the surface.
+SDL_Surface* RasterizeGlyphs( TTF_Font* font, GlyphAtlas* atlas );
+bool UploadGlyphAtlas( SDL_Renderer* renderer, SDL_Surface* packed, GlyphAtlas* atlas );
+void FreeGlyphAtlas( GlyphAtlas* atlas );
+
+// Appends text to batch, which must have been begun on atlas->texture. Characters outside the atlas are skipped.
+// Returns the width drawn.
+int DrawText( SDL_Renderer* renderer, SpriteBatch* batch, const GlyphAtlas* atlas, const char* text, int x, int y, SDL_Color color );
+int MeasureText( const GlyphAtlas* atlas, const char* text );
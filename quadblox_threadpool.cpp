@@ -0,0 +1,122 @@
+#include "quadblox_threadpool.h"
+
+ThreadPool::ThreadPool( int numThreads ) : pending( 0 ), queued( 0 ), nextWorker( 0 ), stopping( false ) {
+    if ( numThreads <= 0 ) {
+        numThreads = int( std::thread::hardware_concurrency() );
+    }
+    if ( numThreads <= 0 ) {
+        numThreads = 1;
+    }
+    for ( int i = 0; i < numThreads; i++ ) {
+        workers.push_back( new Worker() );
+    }
+    for ( int i = 0; i < numThreads; i++ ) {
+        workers[size_t(i)]->thread = std::thread( &ThreadPool::run, this, i );
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    Wait();
+    {
+        std::lock_guard<std::mutex> lk( sleepLock );
+        stopping = true;
+    }
+    wake.notify_all();
+    // Workers still winding down steal from each other, so none may go away until all have stopped
+    for ( size_t i = 0; i < workers.size(); i++ ) {
+        workers[i]->thread.join();
+    }
+    for ( size_t i = 0; i < workers.size(); i++ ) {
+        delete workers[i];
+    }
+}
+
+void ThreadPool::Submit( TaskFn run, void* arg ) {
+    int index = int( nextWorker++ % workers.size() );
+    bool full;
+    {
+        Worker* worker = workers[size_t(index)];
+        std::lock_guard<std::mutex> lk( worker->lock );
+        full = worker->tail - worker->head == POOL_QUEUE_TASKS;
+        if ( !full ) {
+            Task& task = worker->tasks[worker->tail++ % POOL_QUEUE_TASKS];
+            task.run = run;
+            task.arg = arg;
+            pending++;
+            queued++;
+        }
+    }
+    if ( full ) {
+        run( arg );
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lk( sleepLock );
+    }
+    wake.notify_all();
+}
+
+bool ThreadPool::popLocal( int index, Task& out ) {
+    Worker* worker = workers[size_t(index)];
+    std::lock_guard<std::mutex> lk( worker->lock );
+    if ( worker->head == worker->tail ) {
+        return false;
+    }
+    out = worker->tasks[--worker->tail % POOL_QUEUE_TASKS];
+    queued--;
+    return true;
+}
+
+bool ThreadPool::steal( int thief, Task& out ) {
+    int numWorkers = int(workers.size());
+    int start = thief < 0 ? 0 : thief + 1;
+    for ( int i = 0; i < numWorkers; i++ ) {
+        int victim = ( start + i ) % numWorkers;
+        if ( victim == thief ) {
+            continue;
+        }
+        Worker* worker = workers[size_t(victim)];
+        std::lock_guard<std::mutex> lk( worker->lock );
+        if ( worker->head != worker->tail ) {
+            out = worker->tasks[worker->head++ % POOL_QUEUE_TASKS];
+            queued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::finish( const Task& task ) {
+    task.run( task.arg );
+    if ( --pending == 0 ) {
+        std::lock_guard<std::mutex> lk( sleepLock );
+        wake.notify_all();
+    }
+}
+
+void ThreadPool::run( int index ) {
+    Task task;
+    for ( ;; ) {
+        if ( popLocal( index, task ) || steal( index, task ) ) {
+            finish( task );
+            continue;
+        }
+        std::unique_lock<std::mutex> lk( sleepLock );
+        wake.wait( lk, [this] { return stopping || queued > 0; } );
+        if ( stopping && queued == 0 ) {
+            return;
+        }
+    }
+}
+
+void ThreadPool::Wait() {
+    Task task;
+    while ( pending > 0 ) {
+        if ( steal( -1, task ) ) {
+            finish( task );
+            continue;
+        }
+        std::unique_lock<std::mutex> lk( sleepLock );
+        wake.wait( lk, [this] { return pending == 0 || queued > 0; } );
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Tasks each worker's queue holds before Submit runs further ones on the submitting thread
+const unsigned POOL_QUEUE_TASKS = 4096;
+
+// Work-stealing pool. Submit deals tasks round-robin across the workers' queues; each worker pops its own queue
+// from the back and steals from the front of the others once it runs dry.
+// A task is a plain function and an argument, queued in rings allocated with the pool, so submitting never allocates.
+class ThreadPool {
+public:
+    typedef void (*TaskFn)( void* arg );
+
+    // numThreads <= 0 uses one worker per hardware thread
+    explicit ThreadPool( int numThreads = 0 );
+    ~ThreadPool();
+
+    // run( arg ) on some worker. arg must stay valid until Wait returns. If the chosen worker's queue is full the
+    // task runs right away, on the calling thread.
+    void Submit( TaskFn run, void* arg );
+    // Blocks until every submitted task has finished. The calling thread runs tasks while it waits.
+    // Not for use from inside a task: the running task counts as unfinished, so it would wait forever.
+    void Wait();
+    int NumThreads() const { return int(workers.size()); }
+
+private:
+    struct Task {
+        TaskFn run;
+        void* arg;
+    };
+    static_assert( ( POOL_QUEUE_TASKS & ( POOL_QUEUE_TASKS - 1 ) ) == 0, "queue indices wrap with a mask" );
+
+    // Tasks [head, tail) are queued, indices taken modulo POOL_QUEUE_TASKS
+    struct Worker {
+        std::mutex lock;
+        Task tasks[POOL_QUEUE_TASKS];
+        unsigned head = 0;
+        unsigned tail = 0;
+        std::thread thread;
+    };
+
+    bool popLocal( int index, Task& out );
+    bool steal( int thief, Task& out );
+    void finish( const Task& task );
+    void run( int index );
+
+    std::vector<Worker*> workers;
+    // Tasks submitted but not yet finished, and tasks still sitting in a queue
+    std::atomic<int> pending;
+    std::atomic<int> queued;
+    std::atomic<unsigned> nextWorker;
+    std::mutex sleepLock;
+    std::condition_variable wake;
+    bool stopping;
+};
@@ -0,0 +1,101 @@
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include "quadblox_ttable.h"
+
+static uint64 doubleBits( double value ) {
+    uint64 bits;
+    memcpy( &bits, &value, sizeof( bits ) );
+    return bits;
+}
+
+static double bitsDouble( uint64 bits ) {
+    double value;
+    memcpy( &value, &bits, sizeof( value ) );
+    return value;
+}
+
+TranspositionTable::TranspositionTable( size_t sizeBytes ) {
+    size_t slots = 1;
+    while ( slots * 2 * sizeof( Entry ) * TT_SHARDS <= sizeBytes ) {
+        slots *= 2;
+    }
+    for ( int i = 0; i < TT_SHARDS; i++ ) {
+        Shard& shard = shards[i];
+        shard.entries = new Entry[slots];
+        shard.mask = slots - 1;
+    }
+    Clear();
+}
+
+TranspositionTable::~TranspositionTable() {
+    for ( int i = 0; i < TT_SHARDS; i++ ) {
+        delete[] shards[i].entries;
+    }
+}
+
+void* TranspositionTable::operator new( size_t size ) {
+    void* memory = NULL;
+    if ( posix_memalign( &memory, alignof( TranspositionTable ), size ) != 0 ) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void TranspositionTable::operator delete( void* memory ) {
+    free( memory );
+}
+
+bool TranspositionTable::Probe( uint64 key, double* outValue ) {
+    Shard& shard = shardFor( key );
+    Entry& entry = shard.entries[key & shard.mask];
+    shard.probes.fetch_add( 1, std::memory_order_relaxed );
+    uint64 value = entry.value.load( std::memory_order_relaxed );
+    if ( ( entry.check.load( std::memory_order_relaxed ) ^ value ) != key ) {
+        return false;
+    }
+    shard.hits.fetch_add( 1, std::memory_order_relaxed );
+    *outValue = bitsDouble( value );
+    return true;
+}
+
+void TranspositionTable::Store( uint64 key, double value ) {
+    Shard& shard = shardFor( key );
+    Entry& entry = shard.entries[key & shard.mask];
+    uint64 bits = doubleBits( value );
+    entry.check.store( key ^ bits, std::memory_order_relaxed );
+    entry.value.store( bits, std::memory_order_relaxed );
+}
+
+void TranspositionTable::Clear() {
+    for ( int i = 0; i < TT_SHARDS; i++ ) {
+        Shard& shard = shards[i];
+        for ( uint64 slot = 0; slot <= shard.mask; slot++ ) {
+            // An all-zero slot would match key 0, so empty slots only answer to the key ~0 instead
+            shard.entries[slot].check.store( ~uint64( 0 ), std::memory_order_relaxed );
+            shard.entries[slot].value.store( 0, std::memory_order_relaxed );
+        }
+        shard.probes.store( 0, std::memory_order_relaxed );
+        shard.hits.store( 0, std::memory_order_relaxed );
+    }
+}
+
+uint64 TranspositionTable::Probes() const {
+    uint64 total = 0;
+    for ( int i = 0; i < TT_SHARDS; i++ ) {
+        total += shards[i].probes.load( std::memory_order_relaxed );
+    }
+    return total;
+}
+
+uint64 TranspositionTable::Hits() const {
+    uint64 total = 0;
+    for ( int i = 0; i < TT_SHARDS; i++ ) {
+        total += shards[i].hits.load( std::memory_order_relaxed );
+    }
+    return total;
+}
+
+size_t TranspositionTable::SizeBytes() const {
+    return size_t( shards[0].mask + 1 ) * sizeof( Entry ) * TT_SHARDS;
+}
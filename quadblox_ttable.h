@@ -0,0 +1,47 @@
+#pragma once
+#include <atomic>
+#include "quadblox_engine.h"
+
+const int TT_SHARDS = 16;
+
+// Fixed-size cache of search values keyed on a 64-bit position key, shared by every search thread without locks.
+// The table is split into shards, each its own allocation with its own counters, picked by the key's top bits; the
+// low bits pick the slot. An entry is stored as key^value next to value, so a read that races a write sees a key
+// mismatch and misses instead of returning another position's value. New values always replace old ones.
+class TranspositionTable {
+public:
+    // sizeBytes is spread over the shards and rounded down to a power of two slots per shard
+    explicit TranspositionTable( size_t sizeBytes );
+    ~TranspositionTable();
+    // Plain new only promises 16-byte alignment before C++17, too little for the shards
+    static void* operator new( size_t size );
+    static void operator delete( void* memory );
+
+    bool Probe( uint64 key, double* outValue );
+    void Store( uint64 key, double value );
+    void Clear();
+
+    uint64 Probes() const;
+    uint64 Hits() const;
+    size_t SizeBytes() const;
+
+private:
+    struct Entry {
+        std::atomic<uint64> check;
+        std::atomic<uint64> value;
+    };
+    // A cache line each, so threads counting probes on different shards don't fight over one line
+    struct alignas( 64 ) Shard {
+        Entry* entries = NULL;
+        uint64 mask = 0;
+        std::atomic<uint64> probes;
+        std::atomic<uint64> hits;
+    };
+    static_assert( sizeof( Shard ) == 64, "a shard must fill exactly one cache line" );
+
+    Shard& shardFor( uint64 key ) { return shards[key >> 60]; }
+
+    Shard shards[TT_SHARDS];
+};
+
+static_assert( TT_SHARDS == 16, "shardFor picks a shard with the key's top four bits" );